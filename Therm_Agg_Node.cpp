@@ -0,0 +1,160 @@
+#include <cmath>
+#include "Therm_Agg_Node.h"
+
+Therm_Agg_Node::Therm_Agg_Node(Therm_Agg_Node* parent)
+: m_parent(parent)
+, m_p_tree_mutex(&m_tree_mutex)
+, m_zone_count(0)
+, m_heating_count(0)
+, m_cooling_count(0)
+, m_temp_count(0)
+, m_temp_sum(0.0)
+{
+    if (nullptr == m_parent)
+    {
+        pthread_mutex_init(&m_tree_mutex, 0);
+    }
+    else
+    {
+        m_p_tree_mutex = m_parent->m_p_tree_mutex;
+    }
+}
+
+Therm_Agg_Node::~Therm_Agg_Node()
+{
+    // Stop notifications first, so no callback can reach this node while it is torn down
+    for (std::list<zone_binding>::iterator it = m_bindings.begin(); it != m_bindings.end(); ++it)
+    {
+        it->p_zone->unsubscribe(it->subscription_ID);
+    }
+
+    // Remove this node's contribution from its ancestors
+    if (nullptr != m_parent)
+    {
+        pthread_mutex_lock(m_p_tree_mutex);
+        bool had_dev = !m_deviations.empty();
+        float old_dev = had_dev ? *m_deviations.rbegin() : 0.0f;
+        m_parent->propagate(-m_zone_count, -m_heating_count, -m_cooling_count, -m_temp_count, -m_temp_sum,
+                            had_dev, old_dev, false, 0.0f);
+        pthread_mutex_unlock(m_p_tree_mutex);
+    }
+    else
+    {
+        pthread_mutex_destroy(&m_tree_mutex);
+    }
+}
+
+int Therm_Agg_Node::add_zone()
+{
+    zone_state zone;
+    zone.status = therm_status_inactive;
+    zone.temp_valid = false;
+    zone.temp = 0.0f;
+    zone.deviation = 0.0f;
+
+    pthread_mutex_lock(m_p_tree_mutex);
+    int zone_ID = static_cast<int>(m_zones.size());
+    m_zones.push_back(zone);
+    propagate(1, 0, 0, 0, 0.0, false, 0.0f, false, 0.0f);
+    pthread_mutex_unlock(m_p_tree_mutex);
+    return zone_ID;
+}
+
+void Therm_Agg_Node::update_zone(int zone_ID, therm_status status, bool temp_valid, float temp, float setpoint)
+{
+    float deviation = temp_valid ? std::fabs(temp - setpoint) : 0.0f;
+
+    pthread_mutex_lock(m_p_tree_mutex);
+    zone_state& zone = m_zones[zone_ID];
+    int heating_delta = (therm_status_heating == status) - (therm_status_heating == zone.status);
+    int cooling_delta = (therm_status_cooling == status) - (therm_status_cooling == zone.status);
+    int temp_count_delta = temp_valid - zone.temp_valid;
+    double temp_sum_delta = (temp_valid ? temp : 0.0) - (zone.temp_valid ? zone.temp : 0.0);
+    bool had_dev = zone.temp_valid;
+    float old_dev = zone.deviation;
+
+    zone.status = status;
+    zone.temp_valid = temp_valid;
+    zone.temp = temp;
+    zone.deviation = deviation;
+
+    propagate(0, heating_delta, cooling_delta, temp_count_delta, temp_sum_delta,
+              had_dev, old_dev, temp_valid, deviation);
+    pthread_mutex_unlock(m_p_tree_mutex);
+}
+
+int Therm_Agg_Node::attach_zone(Thermostat_API* p_zone)
+{
+    int zone_ID = add_zone();
+
+    pthread_mutex_lock(m_p_tree_mutex);
+    m_bindings.push_back(zone_binding());
+    zone_binding& binding = m_bindings.back();
+    binding.p_node = this;
+    binding.zone_ID = zone_ID;
+    binding.p_zone = p_zone;
+    pthread_mutex_unlock(m_p_tree_mutex);
+
+    // The initial state comes through the subscription like every later change, so it can never be
+    // applied after (and overwrite) a newer state
+    binding.subscription_ID = p_zone->subscribe(therm_event_status | therm_event_temp | therm_event_settings
+                                                | therm_event_initial, 0.0f, zone_event, &binding);
+    return zone_ID;
+}
+
+therm_agg_summary Therm_Agg_Node::get_summary()
+{
+    therm_agg_summary summary;
+    pthread_mutex_lock(m_p_tree_mutex);
+    summary.zone_count = m_zone_count;
+    summary.heating_count = m_heating_count;
+    summary.cooling_count = m_cooling_count;
+    summary.temp_count = m_temp_count;
+    summary.avg_temp = (m_temp_count > 0) ? static_cast<float>(m_temp_sum / m_temp_count) : 0.0f;
+    summary.worst_deviation = m_deviations.empty() ? 0.0f : *m_deviations.rbegin();
+    pthread_mutex_unlock(m_p_tree_mutex);
+    return summary;
+}
+
+void Therm_Agg_Node::zone_event(const therm_event& event, void* context)
+{
+    zone_binding* p_binding = static_cast<zone_binding*>(context);
+    p_binding->p_node->update_zone(p_binding->zone_ID, event.status, event.temp_valid, event.temp, event.setpoint);
+}
+
+void Therm_Agg_Node::propagate(int zone_delta, int heating_delta, int cooling_delta, int temp_count_delta,
+                               double temp_sum_delta, bool had_old_dev, float old_dev, bool has_new_dev, float new_dev)
+{
+    bool dev_changed = (had_old_dev != has_new_dev) || (old_dev != new_dev);
+    for (Therm_Agg_Node* p_node = this; nullptr != p_node; p_node = p_node->m_parent)
+    {
+        p_node->m_zone_count += zone_delta;
+        p_node->m_heating_count += heating_delta;
+        p_node->m_cooling_count += cooling_delta;
+        p_node->m_temp_count += temp_count_delta;
+        p_node->m_temp_sum += temp_sum_delta;
+
+        // The worst deviation only needs to move further up the tree while it keeps changing
+        if (dev_changed)
+        {
+            bool had_worst = !p_node->m_deviations.empty();
+            float old_worst = had_worst ? *p_node->m_deviations.rbegin() : 0.0f;
+            if (had_old_dev)
+            {
+                p_node->m_deviations.erase(p_node->m_deviations.find(old_dev));
+            }
+            if (has_new_dev)
+            {
+                p_node->m_deviations.insert(new_dev);
+            }
+            bool has_worst = !p_node->m_deviations.empty();
+            float new_worst = has_worst ? *p_node->m_deviations.rbegin() : 0.0f;
+
+            dev_changed = (had_worst != has_worst) || (old_worst != new_worst);
+            had_old_dev = had_worst;
+            old_dev = old_worst;
+            has_new_dev = has_worst;
+            new_dev = new_worst;
+        }
+    }
+}
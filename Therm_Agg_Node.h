@@ -0,0 +1,106 @@
+#pragma once
+#include <pthread.h>
+#include <list>
+#include <set>
+#include <vector>
+#include "Thermostat_API.h"
+
+// Live summary of every zone below a node of the aggregation tree
+struct therm_agg_summary{
+    int zone_count;
+    int heating_count;
+    int cooling_count;
+    int temp_count;             // Zones that have received a temperature
+    float avg_temp;             // Average over zones that have received a temperature
+    float worst_deviation;      // Largest |temperature - setpoint| of any zone. 0 if temp_count is 0
+};
+
+/// Node of a zone aggregation tree (i.e. floor, building, site). Each node aggregates the zones
+/// attached directly to it plus all of its child nodes. A zone change is applied incrementally to
+/// the node and each of its ancestors, so any summary query is O(1) regardless of the number of zones.
+/// All nodes of a tree share the root's lock. Child nodes must be destroyed before their parent
+class Therm_Agg_Node {
+
+public:
+/// @param parent       Parent node, or nullptr for the root of a tree
+Therm_Agg_Node(Therm_Agg_Node* parent);
+
+~Therm_Agg_Node();
+
+/// Add a zone to this node. The zone starts inactive with no temperature
+/// @return             int zone ID (local to this node) to pass to update_zone
+int add_zone();
+
+/// Update the state of a zone. Cost is O(depth * log(fanout)) to update every ancestor
+/// @param zone_ID      ID returned by add_zone
+/// @param status       Current thermostat status of the zone
+/// @param temp_valid   True if the zone has received a temperature
+/// @param temp         Current temperature of the zone. Only used if temp_valid is true
+/// @param setpoint     Current temperature setpoint of the zone
+/// @return             Nothing (void)
+void update_zone(int zone_ID, therm_status status, bool temp_valid, float temp, float setpoint);
+
+/// Add a thermostat as a zone of this node, and keep the zone up to date through a change
+/// notification subscription. The zone's initial state arrives as the subscription's first
+/// notification, shortly after this returns. The subscription is removed when this node is destroyed
+/// @param p_zone       Thermostat to aggregate. Must outlive this node
+/// @return             int zone ID (local to this node)
+int attach_zone(Thermostat_API* p_zone);
+
+/// Get the live summary of every zone below this node
+/// @return             therm_agg_summary summary
+therm_agg_summary get_summary();
+
+private:
+// Latest state of a zone attached directly to this node
+struct zone_state{
+    therm_status status;
+    bool temp_valid;
+    float temp;
+    float deviation;
+};
+
+// Subscription routing a thermostat's notifications to one of this node's zones
+struct zone_binding{
+    Therm_Agg_Node* p_node;
+    int zone_ID;
+    Thermostat_API* p_zone;
+    int subscription_ID;
+};
+
+/// Subscription callback. Applies a thermostat change notification to its zone
+/// @param event        The change notification
+/// @param context      zone_binding* identifying the node and zone
+/// @return             Nothing (void)
+static void zone_event(const therm_event& event, void* context);
+
+/// Apply a change to this node and propagate it to every ancestor. Caller must hold the tree lock
+/// @param zone_delta       Change in the number of zones
+/// @param heating_delta    Change in the number of heating zones
+/// @param cooling_delta    Change in the number of cooling zones
+/// @param temp_count_delta Change in the number of zones with a temperature
+/// @param temp_sum_delta   Change in the sum of zone temperatures
+/// @param had_old_dev      True if old_dev was present in this node's deviation set
+/// @param old_dev          Deviation to remove from this node's deviation set
+/// @param has_new_dev      True if new_dev should be added to this node's deviation set
+/// @param new_dev          Deviation to add to this node's deviation set
+/// @return                 Nothing (void)
+void propagate(int zone_delta, int heating_delta, int cooling_delta, int temp_count_delta, double temp_sum_delta,
+               bool had_old_dev, float old_dev, bool has_new_dev, float new_dev);
+
+// Member variables
+Therm_Agg_Node* m_parent;
+pthread_mutex_t m_tree_mutex;           // Only used by the root node
+pthread_mutex_t* m_p_tree_mutex;        // The root node's lock, shared by the whole tree
+std::vector<zone_state> m_zones;
+std::list<zone_binding> m_bindings;
+int m_zone_count;
+int m_heating_count;
+int m_cooling_count;
+int m_temp_count;
+double m_temp_sum;
+// Deviations of the zones attached to this node, and the worst deviation of each child node.
+// The largest entry is this node's worst deviation
+std::multiset<float> m_deviations;
+
+};
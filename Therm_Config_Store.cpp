@@ -0,0 +1,212 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Therm_Config_Store.h"
+
+Therm_Config_Store::Therm_Config_Store(int slot_count, const therm_config& initial)
+: m_p_table(nullptr)
+, m_epoch(0)
+{
+    pthread_mutex_init(&m_writer_mutex, 0);
+    m_readers[0] = 0;
+    m_readers[1] = 0;
+
+    therm_config_table* p_table = new therm_config_table();
+    p_table->version = 1;
+    p_table->configs.assign(slot_count, initial);
+    m_p_table = p_table;
+}
+
+Therm_Config_Store::~Therm_Config_Store()
+{
+    delete m_p_table.load();
+    pthread_mutex_destroy(&m_writer_mutex);
+}
+
+int Therm_Config_Store::get_slot_count()
+{
+    Therm_Config_Reader reader(*this);
+    return static_cast<int>(reader.get_table().configs.size());
+}
+
+therm_config Therm_Config_Store::get_config(int slot, unsigned long& version)
+{
+    Therm_Config_Reader reader(*this);
+    version = reader.get_table().version;
+    return reader.get_table().configs[slot];
+}
+
+therm_err Therm_Config_Store::publish(const std::vector<therm_config>& configs)
+{
+    therm_err ret_err = therm_err_none;
+    pthread_mutex_lock(&m_writer_mutex);
+    therm_config_table* p_current = m_p_table;
+    if (configs.size() != p_current->configs.size())
+    {
+        ret_err = therm_err_bad_config;
+    }
+    else
+    {
+        therm_config_table* p_table = new therm_config_table();
+        p_table->version = p_current->version + 1;
+        p_table->configs = configs;
+        swap_table(p_table);
+    }
+    pthread_mutex_unlock(&m_writer_mutex);
+    return ret_err;
+}
+
+therm_err Therm_Config_Store::update_slot(int slot, int field_mask, const therm_config& config)
+{
+    pthread_mutex_lock(&m_writer_mutex);
+    if ((slot < 0) || (slot >= static_cast<int>(m_p_table.load()->configs.size())))
+    {
+        pthread_mutex_unlock(&m_writer_mutex);
+        return therm_err_bad_config;
+    }
+    // Writers are serialised, so the current snapshot can be read without entering the epoch
+    therm_config_table* p_table = new therm_config_table(*m_p_table);
+    p_table->version++;
+    therm_config& slot_config = p_table->configs[slot];
+    if (field_mask & therm_config_field_mode)
+    {
+        slot_config.mode = config.mode;
+    }
+    if (field_mask & therm_config_field_setpoint)
+    {
+        slot_config.setpoint = config.setpoint;
+    }
+    if (field_mask & therm_config_field_margin)
+    {
+        slot_config.margin = config.margin;
+    }
+    swap_table(p_table);
+    pthread_mutex_unlock(&m_writer_mutex);
+    return therm_err_none;
+}
+
+therm_err Therm_Config_Store::load_file(const char* path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return therm_err_bad_config;
+    }
+
+    pthread_mutex_lock(&m_writer_mutex);
+    therm_config_table* p_table = new therm_config_table(*m_p_table);
+    p_table->version++;
+
+    // Parse the whole file before publishing anything
+    therm_err ret_err = therm_err_none;
+    std::string line;
+    while ((therm_err_none == ret_err) && std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first) || ('#' == first[0]))
+        {
+            continue;
+        }
+
+        std::istringstream slot_field(first);
+        int slot = -1;
+        std::string mode_name;
+        therm_config config;
+        std::string extra;
+        if (!(slot_field >> slot) || !(fields >> mode_name >> config.setpoint >> config.margin) || (fields >> extra)
+            || (slot < 0) || (slot >= static_cast<int>(p_table->configs.size())))
+        {
+            ret_err = therm_err_bad_config;
+        }
+        else if ("off" == mode_name)
+        {
+            config.mode = therm_mode_off;
+        }
+        else if ("heat" == mode_name)
+        {
+            config.mode = therm_mode_heat;
+        }
+        else if ("cool" == mode_name)
+        {
+            config.mode = therm_mode_cool;
+        }
+        else if ("auto" == mode_name)
+        {
+            config.mode = therm_mode_auto;
+        }
+        else
+        {
+            ret_err = therm_err_bad_config;
+        }
+
+        if (therm_err_none == ret_err)
+        {
+            p_table->configs[slot] = config;
+        }
+    }
+
+    if (therm_err_none == ret_err)
+    {
+        swap_table(p_table);
+    }
+    else
+    {
+        delete p_table;
+    }
+    pthread_mutex_unlock(&m_writer_mutex);
+    return ret_err;
+}
+
+int Therm_Config_Store::read_enter()
+{
+    while (1)
+    {
+        unsigned long epoch = m_epoch;
+        int epoch_index = static_cast<int>(epoch & 1);
+        m_readers[epoch_index]++;
+        // If a writer advanced the epoch in the meantime, it may not have seen this reader. Try again
+        if (epoch == m_epoch)
+        {
+            return epoch_index;
+        }
+        m_readers[epoch_index]--;
+    }
+}
+
+void Therm_Config_Store::read_exit(int epoch_index)
+{
+    m_readers[epoch_index]--;
+}
+
+void Therm_Config_Store::swap_table(therm_config_table* p_table)
+{
+    therm_config_table* p_old = m_p_table.exchange(p_table);
+
+    // Readers that arrive from here on see the new snapshot. Wait out the readers of the old epoch
+    unsigned long epoch = m_epoch;
+    m_epoch = epoch + 1;
+    while (0 != m_readers[epoch & 1])
+    {
+        std::this_thread::yield();
+    }
+    delete p_old;
+}
+
+Therm_Config_Reader::Therm_Config_Reader(Therm_Config_Store& store)
+: m_store(store)
+, m_epoch_index(store.read_enter())
+, m_p_table(store.m_p_table)
+{
+}
+
+Therm_Config_Reader::~Therm_Config_Reader()
+{
+    m_store.read_exit(m_epoch_index);
+}
+
+const therm_config_table& Therm_Config_Reader::get_table()
+{
+    return *m_p_table;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <pthread.h>
+#include <atomic>
+#include <vector>
+#include "Thermostat_API.h"
+
+// Settings fields, combined into a mask to update part of a slot's settings
+enum therm_config_field{
+    therm_config_field_mode = 0x1,
+    therm_config_field_setpoint = 0x2,
+    therm_config_field_margin = 0x4,
+    therm_config_field_all = 0x7
+};
+
+// Immutable snapshot of the settings of every slot. Never modified once published
+struct therm_config_table{
+    unsigned long version;
+    std::vector<therm_config> configs;
+};
+
+/// Settings for one or more thermostats (one slot per thermostat), published as a whole with an
+/// RCU style pointer swap. Readers never lock: they announce themselves in the current epoch, read
+/// the current snapshot, and leave. Writers build a new snapshot, swap it in, advance the epoch, and
+/// free the old snapshot once every reader of the old epoch has left. An update to any number of
+/// slots is therefore seen by readers either in full or not at all
+class Therm_Config_Store {
+
+public:
+/// @param slot_count   Number of thermostats sharing the store
+/// @param initial      Settings every slot starts with
+Therm_Config_Store(int slot_count, const therm_config& initial);
+
+~Therm_Config_Store();
+
+/// Return the number of slots in the store
+/// @return             int slot count
+int get_slot_count();
+
+/// Read the settings of one slot. Lock free
+/// @param slot         Slot to read. Must be in range (0 to get_slot_count() - 1)
+/// @param version      Set to the version of the snapshot that was read
+/// @return             therm_config settings of the slot
+therm_config get_config(int slot, unsigned long& version);
+
+/// Replace the settings of every slot in a single atomic update
+/// @param configs      New settings, one per slot
+/// @return             therm_err. None, or bad_config if the number of settings doesn't match the slot count
+therm_err publish(const std::vector<therm_config>& configs);
+
+/// Update some of the settings of one slot. Copies the whole snapshot, so prefer publish or
+/// load_file when changing many slots at once
+/// @param slot         Slot to update
+/// @param field_mask   Mask of therm_config_field values to take from config
+/// @param config       New settings
+/// @return             therm_err. None, or bad_config if the slot is out of range (nothing is applied)
+therm_err update_slot(int slot, int field_mask, const therm_config& config);
+
+/// Load settings from a file and publish them in a single atomic update. Each line holds
+/// "<slot> <mode> <setpoint> <margin>", where mode is off, heat, cool or auto. Blank lines and lines
+/// starting with # are ignored. Slots that aren't listed keep their current settings
+/// @param path         Path of the settings file
+/// @return             therm_err. None, or bad_config if the file can't be read or parsed (nothing is applied)
+therm_err load_file(const char* path);
+
+private:
+friend class Therm_Config_Reader;
+
+/// Enter a read-side critical section. The current snapshot can't be freed until read_exit
+/// @return             int epoch index to pass to read_exit
+int read_enter();
+
+/// Leave a read-side critical section
+/// @param epoch_index  Value returned by read_enter
+/// @return             Nothing (void)
+void read_exit(int epoch_index);
+
+/// Publish a new snapshot and free the old one once no reader can still be using it.
+/// Caller must hold the writer lock
+/// @param p_table      New snapshot. Ownership passes to the store
+/// @return             Nothing (void)
+void swap_table(therm_config_table* p_table);
+
+// Member variables
+pthread_mutex_t m_writer_mutex;
+std::atomic<therm_config_table*> m_p_table;
+std::atomic<unsigned long> m_epoch;
+std::atomic<long> m_readers[2];     // Readers in the even and odd epochs
+
+};
+
+/// Read-side critical section (RAII) for readers that need several slots from the same snapshot
+class Therm_Config_Reader {
+
+public:
+/// @param store        Store to read from
+Therm_Config_Reader(Therm_Config_Store& store);
+
+~Therm_Config_Reader();
+
+/// Return the snapshot being read. Valid until the reader is destroyed
+/// @return             const therm_config_table& snapshot
+const therm_config_table& get_table();
+
+private:
+Therm_Config_Store& m_store;
+int m_epoch_index;
+const therm_config_table* m_p_table;
+
+};
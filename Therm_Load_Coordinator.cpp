@@ -0,0 +1,185 @@
+#include "Therm_Load_Coordinator.h"
+
+Therm_Load_Coordinator::Therm_Load_Coordinator(int max_active, int rotation_ticks)
+: m_max_active(max_active)
+, m_rotation_ticks(rotation_ticks)
+, m_active_count(0)
+, m_peak_active(0)
+, m_next_seq(0)
+{
+    pthread_mutex_init(&m_mutex, 0);
+}
+
+Therm_Load_Coordinator::~Therm_Load_Coordinator()
+{
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int Therm_Load_Coordinator::register_unit()
+{
+    unit_info unit;
+    unit.state = unit_state_idle;
+    unit.key.deviation = 0.0f;
+    unit.key.seq = 0;
+    unit.run_ticks = 0;
+
+    pthread_mutex_lock(&m_mutex);
+    int unit_ID = 0;
+    if (m_free_unit_IDs.empty())
+    {
+        unit_ID = static_cast<int>(m_units.size());
+        unit.key.unit_ID = unit_ID;
+        m_units.push_back(unit);
+    }
+    else
+    {
+        unit_ID = m_free_unit_IDs.back();
+        m_free_unit_IDs.pop_back();
+        unit.key.unit_ID = unit_ID;
+        m_units[unit_ID] = unit;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return unit_ID;
+}
+
+void Therm_Load_Coordinator::unregister_unit(int unit_ID)
+{
+    pthread_mutex_lock(&m_mutex);
+    release_unit(m_units[unit_ID]);
+    m_free_unit_IDs.push_back(unit_ID);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool Therm_Load_Coordinator::request_start(int unit_ID, float deviation)
+{
+    bool is_granted = false;
+    pthread_mutex_lock(&m_mutex);
+    unit_info& unit = m_units[unit_ID];
+    if (unit_state_active == unit.state)
+    {
+        is_granted = true;
+    }
+    else if (unit_state_reserved == unit.state)
+    {
+        unit.state = unit_state_active;
+        unit.run_ticks = 0;
+        is_granted = true;
+    }
+    else if (m_active_count < m_max_active)
+    {
+        // A free slot means nobody is waiting (slots are handed to waiters as soon as they free up)
+        if (unit_state_waiting == unit.state)
+        {
+            m_waiting.erase(unit.key);
+        }
+        unit.state = unit_state_active;
+        unit.run_ticks = 0;
+        m_active_count++;
+        if (m_active_count > m_peak_active)
+        {
+            m_peak_active = m_active_count;
+        }
+        is_granted = true;
+    }
+    else if (unit_state_waiting == unit.state)
+    {
+        // Re-prioritise on the latest deviation, keeping the unit's place among equals
+        if (deviation != unit.key.deviation)
+        {
+            m_waiting.erase(unit.key);
+            unit.key.deviation = deviation;
+            m_waiting.insert(unit.key);
+        }
+    }
+    else
+    {
+        unit.state = unit_state_waiting;
+        unit.key.deviation = deviation;
+        unit.key.seq = m_next_seq++;
+        m_waiting.insert(unit.key);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return is_granted;
+}
+
+void Therm_Load_Coordinator::release(int unit_ID)
+{
+    pthread_mutex_lock(&m_mutex);
+    release_unit(m_units[unit_ID]);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool Therm_Load_Coordinator::should_yield(int unit_ID)
+{
+    bool is_yielding = false;
+    pthread_mutex_lock(&m_mutex);
+    unit_info& unit = m_units[unit_ID];
+    if (unit_state_active == unit.state)
+    {
+        unit.run_ticks++;
+        is_yielding = (m_rotation_ticks > 0) && (unit.run_ticks >= m_rotation_ticks) && !m_waiting.empty();
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return is_yielding;
+}
+
+int Therm_Load_Coordinator::get_unit_count()
+{
+    pthread_mutex_lock(&m_mutex);
+    int count = static_cast<int>(m_units.size() - m_free_unit_IDs.size());
+    pthread_mutex_unlock(&m_mutex);
+    return count;
+}
+
+int Therm_Load_Coordinator::get_active_count()
+{
+    pthread_mutex_lock(&m_mutex);
+    int count = m_active_count;
+    pthread_mutex_unlock(&m_mutex);
+    return count;
+}
+
+int Therm_Load_Coordinator::get_waiting_count()
+{
+    pthread_mutex_lock(&m_mutex);
+    int count = static_cast<int>(m_waiting.size());
+    pthread_mutex_unlock(&m_mutex);
+    return count;
+}
+
+int Therm_Load_Coordinator::get_peak_active()
+{
+    pthread_mutex_lock(&m_mutex);
+    int count = m_peak_active;
+    pthread_mutex_unlock(&m_mutex);
+    return count;
+}
+
+void Therm_Load_Coordinator::release_unit(unit_info& unit)
+{
+    if ((unit_state_active == unit.state) || (unit_state_reserved == unit.state))
+    {
+        unit.state = unit_state_idle;
+        grant_next();
+    }
+    else if (unit_state_waiting == unit.state)
+    {
+        m_waiting.erase(unit.key);
+        unit.state = unit_state_idle;
+    }
+}
+
+void Therm_Load_Coordinator::grant_next()
+{
+    if (m_waiting.empty())
+    {
+        m_active_count--;
+    }
+    else
+    {
+        // Hand the slot straight to the most urgent waiter. The active count is unchanged
+        std::set<wait_key>::iterator next = m_waiting.begin();
+        m_units[next->unit_ID].state = unit_state_reserved;
+        m_waiting.erase(next);
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <pthread.h>
+#include <set>
+#include <vector>
+
+/// Site-wide demand-response coordinator. Caps how many heating/cooling units may run at once.
+/// Units that want to start while the site is at its cap wait in a queue ordered by comfort
+/// deviation (largest first, then longest waiting). When a unit stops, its slot is handed to the
+/// front of the queue. Optionally, a unit that has run for a number of controller ticks while
+/// others are waiting is asked to yield, so service rotates fairly between units.
+/// Every operation is O(log n) in the number of waiting units
+class Therm_Load_Coordinator {
+
+public:
+/// @param max_active       Most units allowed to run at once
+/// @param rotation_ticks   Controller ticks a unit may run while others wait before it is asked to
+///                         yield. 0 disables rotation
+Therm_Load_Coordinator(int max_active, int rotation_ticks);
+
+~Therm_Load_Coordinator();
+
+/// Register a unit with the coordinator
+/// @return             int unit ID to pass to the other functions
+int register_unit();
+
+/// Remove a unit from the coordinator. Its slot is released (or it leaves the queue) first, and its
+/// ID may be handed out again by register_unit
+/// @param unit_ID      ID returned by register_unit
+/// @return             Nothing (void)
+void unregister_unit(int unit_ID);
+
+/// Ask to start (or keep running) a unit. If the site is at its cap, the unit is queued (or its
+/// place in the queue is updated) and will be granted the next free slot in priority order
+/// @param unit_ID      ID returned by register_unit
+/// @param deviation    How far the unit's zone is from its setpoint. Larger is more urgent
+/// @return             true if the unit may run now
+bool request_start(int unit_ID, float deviation);
+
+/// Release a unit's slot (or withdraw it from the queue) because it stopped or no longer wants to run
+/// @param unit_ID      ID returned by register_unit
+/// @return             Nothing (void)
+void release(int unit_ID);
+
+/// Called once per controller tick by a running unit. Returns true once the unit has used up its
+/// rotation quantum while other units are waiting, in which case it should stop and release its slot
+/// @param unit_ID      ID returned by register_unit
+/// @return             true if the unit should yield its slot
+bool should_yield(int unit_ID);
+
+/// Get the number of registered units
+/// @return             int registered unit count
+int get_unit_count();
+
+/// Get the number of units running or holding a reserved slot
+/// @return             int active unit count
+int get_active_count();
+
+/// Get the number of units waiting for a slot
+/// @return             int waiting unit count
+int get_waiting_count();
+
+/// Get the largest number of units that have been active at once
+/// @return             int peak active unit count
+int get_peak_active();
+
+private:
+enum unit_state{
+    unit_state_idle = 0,
+    unit_state_waiting,
+    unit_state_reserved,    // Granted a slot while waiting. Becomes active on its next request_start
+    unit_state_active
+};
+
+// Queue ordering key. Largest deviation first, then first come first served
+struct wait_key{
+    float deviation;
+    unsigned long seq;
+    int unit_ID;
+    bool operator<(const wait_key& other) const
+    {
+        if (deviation != other.deviation)
+        {
+            return deviation > other.deviation;
+        }
+        return seq < other.seq;
+    }
+};
+
+struct unit_info{
+    unit_state state;
+    wait_key key;           // Only valid while waiting
+    int run_ticks;          // Ticks run since the slot was granted
+};
+
+/// Release a unit's slot or withdraw it from the queue. Caller must hold the lock
+/// @param unit         The unit to release
+/// @return             Nothing (void)
+void release_unit(unit_info& unit);
+
+/// Free a slot and hand it to the front of the queue. Caller must hold the lock
+/// @return             Nothing (void)
+void grant_next();
+
+// Member variables
+pthread_mutex_t m_mutex;
+int m_max_active;
+int m_rotation_ticks;
+int m_active_count;
+int m_peak_active;
+unsigned long m_next_seq;
+std::vector<unit_info> m_units;
+std::vector<int> m_free_unit_IDs;   // Unregistered IDs, reused before m_units grows
+std::set<wait_key> m_waiting;
+
+};
@@ -2,19 +2,85 @@
 #include <iomanip>
 #include <chrono>
 #include <thread>
+#include <cmath>
+#include <algorithm>
 #include "Thermostat_API.h"
+#include "Therm_Load_Coordinator.h"
+#include "Therm_Config_Store.h"
 
-// Constructor. Set defaults for certain member variables
+// Plausible range for sensor temperature readings (farenheit). Anything outside of this range
+// is treated as a corrupt message rather than a real temperature
+static const float temp_min_valid = -100.0f;
+static const float temp_max_valid = 200.0f;
+
+// Bounds on the sensor reporting interval advertised by the UDP listener. The controller acts once a
+// second, so reporting faster than that can't reduce control latency
+static const uint32_t sample_interval_min_ms = 1000;
+static const uint32_t sample_interval_max_ms = 10000;
+
+// Fraction of the predicted time (and distance) to the next switching threshold used for the advertised
+// interval (and deadband), leaving room for the temperature to change faster than predicted
+static const float sample_safety_factor = 0.5f;
+
+// Slowest temperature rate of change (degrees per second) assumed when predicting threshold crossings
+static const float sample_min_temp_rate = 0.01f;
+
+// How often the UDP listener logs a summary of the messages it received. Logging each message would
+// flood the console (and slow the listener) when a faulty sensor network floods it
+static const int rx_log_period_ms = 1000;
+
+// Default thermostat settings: off, 72 degree setpoint, 1 degree margin
+static const therm_config default_config = { therm_mode_off, 72.0f, 1.0f };
+
+// Constructor. Settings are kept in a private single slot configuration store
 Thermostat_API::Thermostat_API()
+: Thermostat_API(nullptr, 0)
+{
+}
+
+// Constructor. Set defaults for certain member variables
+Thermostat_API::Thermostat_API(Therm_Config_Store* p_config_store, int config_slot)
 : m_therm_status(therm_status_inactive)
-, m_therm_mode(therm_mode_off)
 , m_temp_port(1234)
 , m_temp(0.0f)
-, m_temp_margin(1.0f)
-, m_temp_setpoint(72.0f)
+, m_p_config_store(p_config_store)
+, m_config_slot(config_slot)
+, m_config_version(0)
 , m_is_temp_valid(false)
 , m_therm_cont_err(therm_err_no_temp_data)
+, m_rx_count(0)
+, m_rx_reject_count(0)
+, m_notify_pending(false)
+, m_next_subscription_ID(1)
+, m_p_coordinator(nullptr)
+, m_coordinator_unit_ID(0)
+, m_has_sensor_addr(false)
+, m_last_sample_temp(0.0f)
+, m_temp_rate(0.0f)
+, m_has_advert(false)
+, m_advert_interval_ms(0)
+, m_advert_deadband(0.0f)
 {
+  // Never index outside the shared store. Fall back to private settings instead
+  if ((nullptr != m_p_config_store)
+      && ((m_config_slot < 0) || (m_config_slot >= m_p_config_store->get_slot_count())))
+  {
+      std::cout << "Error: configuration slot " << m_config_slot << " is out of range. Using private settings" << std::endl;
+      m_p_config_store = nullptr;
+  }
+  if (nullptr == m_p_config_store)
+  {
+      m_p_private_config_store.reset(new Therm_Config_Store(1, default_config));
+      m_p_config_store = m_p_private_config_store.get();
+      m_config_slot = 0;
+  }
+
+  pthread_mutex_init(&m_notify_mutex, 0);
+  pthread_mutex_init(&m_sample_mutex, 0);
+  pthread_mutex_init(&m_coordinator_mutex, 0);
+  pthread_cond_init(&m_notify_cond, 0);
+  pthread_mutex_init(&m_subscriber_mutex, 0);
+  pthread_create(&m_notify_thread, 0, notify_dispatcher, (void*)this);
   pthread_create(&m_therm_thread, 0, therm_controller, (void*)this);
 }
 
@@ -24,15 +90,31 @@ void* Thermostat_API::therm_controller(void* context)
 
     while (1)
     {
+        // The load coordinator can't be changed part way through a tick
+        pthread_mutex_lock(&p_this->m_coordinator_mutex);
         float current_temp = 0.0f;
+        bool is_requesting_load = false;
+
+        // Take one settings snapshot for the whole tick, so a concurrent update is either seen in full or not at all
+        unsigned long config_version = 0;
+        therm_config config = p_this->m_p_config_store->get_config(p_this->m_config_slot, config_version);
+        if (config_version != p_this->m_config_version)
+        {
+            // Settings may have been published in bulk, bypassing the setters. Let subscribers know
+            p_this->m_config_version = config_version;
+            p_this->notify_change();
+        }
+
         if (therm_err_no_temp_data == p_this->get_temp(current_temp))
         {
-            p_this->m_therm_cont_err = therm_err_no_temp_data;
+            p_this->set_therm_cont_err(therm_err_no_temp_data);
         }
         else
         {
+            p_this->set_therm_cont_err(therm_err_none);
+
             // If the thermostate is set to off, make sure it's not heating or cooling
-            if (therm_mode_off == p_this->get_therm_mode())
+            if (therm_mode_off == config.mode)
             {
                 if (therm_status_heating == p_this->get_therm_status()) 
                 {
@@ -48,32 +130,42 @@ void* Thermostat_API::therm_controller(void* context)
                 }
             }
             // If set to cool eithin a tolerance (auto or cool), start cooling if the temperature
-            // is above the setpoint + margin. Only start the AC if it hasn't already been started
-            else if (   ((therm_mode_cool == p_this->get_therm_mode()) 
-                                || (therm_mode_auto == p_this->get_therm_mode()))
-                        && (current_temp > p_this->get_temp_setpoint() + p_this->get_temp_margin()) 
+            // is above the setpoint + margin. Only start the AC if it hasn't already been started,
+            // and the load coordinator (if any) has a slot for it
+            else if (   ((therm_mode_cool == config.mode) 
+                                || (therm_mode_auto == config.mode))
+                        && (current_temp > config.setpoint + config.margin) 
                         && (therm_status_cooling != p_this->get_therm_status()) )
             {
-                p_this->start_cooling();
+                is_requesting_load = true;
+                if (p_this->acquire_load_slot(current_temp - config.setpoint))
+                {
+                    p_this->start_cooling();
+                }
             }
             // If set to heat eithin a tolerance (auto or heat), start heating if the temperature
-            // is below the setpoint - margin. Only start the heater if it hasn't already been started
-            else if (   ((therm_mode_heat == p_this->get_therm_mode()) 
-                                || (therm_mode_auto == p_this->get_therm_mode()))
-                        && (current_temp < p_this->get_temp_setpoint() - p_this->get_temp_margin())
+            // is below the setpoint - margin. Only start the heater if it hasn't already been started,
+            // and the load coordinator (if any) has a slot for it
+            else if (   ((therm_mode_heat == config.mode) 
+                                || (therm_mode_auto == config.mode))
+                        && (current_temp < config.setpoint - config.margin)
                         && (therm_status_heating != p_this->get_therm_status()) )
             {
-                p_this->start_heating();
+                is_requesting_load = true;
+                if (p_this->acquire_load_slot(config.setpoint - current_temp))
+                {
+                    p_this->start_heating();
+                }
             }
             // If currently heating, and temp is above setpoint, then stop heating
             else if ( (therm_status_heating == p_this->get_therm_status()) 
-                      && (current_temp >= p_this->get_temp_setpoint()) )
+                      && (current_temp >= config.setpoint) )
             {
                 p_this->stop_heating();
             }
             // If currently cooling, and temp is below setpoint, then stop cooling
             else if ( (therm_status_cooling == p_this->get_therm_status()) 
-                      && (current_temp <= p_this->get_temp_setpoint()) )
+                      && (current_temp <= config.setpoint) )
             {
                 p_this->stop_cooling();
             }
@@ -81,7 +173,34 @@ void* Thermostat_API::therm_controller(void* context)
             {
                 // Do nothing. No action needed
             }
+
+            // Give up a queued or reserved load slot that is no longer needed, and yield a running
+            // slot if the load coordinator is rotating service to other waiting zones
+            Therm_Load_Coordinator* p_coordinator = p_this->m_p_coordinator;
+            if (nullptr != p_coordinator)
+            {
+                if ((therm_status_inactive == p_this->get_therm_status()) && !is_requesting_load)
+                {
+                    p_this->release_load_slot();
+                }
+                else if ( (therm_status_inactive != p_this->get_therm_status())
+                          && p_coordinator->should_yield(p_this->m_coordinator_unit_ID) )
+                {
+                    if (therm_status_heating == p_this->get_therm_status())
+                    {
+                        p_this->stop_heating();
+                    }
+                    else
+                    {
+                        p_this->stop_cooling();
+                    }
+                }
+            }
+
+            // Settings or status may have moved the switching thresholds. Update the sensor's reporting rate
+            p_this->advertise_sample_rate();
         }
+        pthread_mutex_unlock(&p_this->m_coordinator_mutex);
         // Sleep for a second to avoid busy loop
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
@@ -90,20 +209,178 @@ void* Thermostat_API::therm_controller(void* context)
 void* Thermostat_API::temp_UDP_listener(void* context)
 {
     Thermostat_API* p_this = static_cast<Thermostat_API*>(context);
-    char buffer[4];
+    // Receive into a buffer larger than a temperature message so oversized messages can be detected
+    char buffer[16];
     struct sockaddr_in si_other;
     socklen_t addr_size;
-    float value;
+    float value = 0.0f;
+    // Messages received since the last log summary
+    unsigned long log_rx_count = 0;
+    unsigned long log_malformed_count = 0;
+    unsigned long log_implausible_count = 0;
+    std::chrono::steady_clock::time_point log_time = std::chrono::steady_clock::now();
     while (1)
     {
         // Continuously attempt to receive incoming messages on the UDP socket
-        recvfrom(p_this->m_socket_ID, &value, sizeof(float), 0, (struct sockaddr*)& si_other, &addr_size);
+        addr_size = sizeof(si_other);
+        ssize_t length = recvfrom(p_this->m_socket_ID, buffer, sizeof(buffer), 0, (struct sockaddr*)& si_other, &addr_size);
+        if (length < 0)
+        {
+            continue;
+        }
+
+        // Log what was received since the last summary, at most once per log period
+        if (std::chrono::steady_clock::now() - log_time >= std::chrono::milliseconds(rx_log_period_ms))
+        {
+            if (0 != log_rx_count)
+            {
+                std::cout << "Information: " << log_rx_count << " temperature messages received from client. Latest: "
+                          << std::fixed << std::setprecision(2) << value << std::endl;
+            }
+            if ((0 != log_malformed_count) || (0 != log_implausible_count))
+            {
+                std::cout << "Warning: " << log_malformed_count << " malformed and " << log_implausible_count
+                          << " implausible temperature messages discarded" << std::endl;
+            }
+            log_rx_count = 0;
+            log_malformed_count = 0;
+            log_implausible_count = 0;
+            log_time = std::chrono::steady_clock::now();
+        }
+
+        // Reject truncated, oversized, and corrupt messages so they never reach the controller
+        if (sizeof(float) != static_cast<size_t>(length))
+        {
+            p_this->m_rx_reject_count++;
+            log_malformed_count++;
+            continue;
+        }
+        float received;
+        memcpy(&received, buffer, sizeof(float));
+        if (!std::isfinite(received) || (received < temp_min_valid) || (received > temp_max_valid))
+        {
+            p_this->m_rx_reject_count++;
+            log_implausible_count++;
+            continue;
+        }
+        value = received;
+        log_rx_count++;
         p_this->m_temp = value;
         p_this->m_is_temp_valid = true;
-        std::cout << "Information: data received from client: " << std::fixed << std::setprecision(2) << value << std::endl;
+        p_this->m_rx_count++;
+        p_this->notify_change();
+
+        // Track how fast the temperature is changing, then tell the sensor how often to report
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        pthread_mutex_lock(&p_this->m_sample_mutex);
+        if (p_this->m_has_sensor_addr)
+        {
+            float elapsed_s = std::chrono::duration<float>(now - p_this->m_last_sample_time).count();
+            if (elapsed_s > 0.0f)
+            {
+                float rate = std::fabs(value - p_this->m_last_sample_temp) / elapsed_s;
+                p_this->m_temp_rate = 0.7f * p_this->m_temp_rate + 0.3f * rate;
+            }
+        }
+        if (!p_this->m_has_sensor_addr || (0 != memcmp(&si_other, &p_this->m_sensor_addr, sizeof(si_other))))
+        {
+            // New sensor. Make sure it gets an advertisement
+            p_this->m_sensor_addr = si_other;
+            p_this->m_has_sensor_addr = true;
+            p_this->m_has_advert = false;
+        }
+        else if ( p_this->m_has_advert
+                  && (now - p_this->m_last_sample_time < std::chrono::milliseconds(p_this->m_advert_interval_ms))
+                  && (std::fabs(value - p_this->m_last_sample_temp) <= p_this->m_advert_deadband)
+                  && (now - p_this->m_advert_time >= std::chrono::milliseconds(sample_interval_min_ms)) )
+        {
+            // The sensor is reporting faster than advertised. It may have missed the advertisement
+            // (or restarted), so advertise again. At most once per minimum interval for sensors that ignore it
+            p_this->m_has_advert = false;
+        }
+        p_this->m_last_sample_time = now;
+        p_this->m_last_sample_temp = value;
+        pthread_mutex_unlock(&p_this->m_sample_mutex);
+        p_this->advertise_sample_rate();
+    }
+}
+
+void* Thermostat_API::notify_dispatcher(void* context)
+{
+    Thermostat_API* p_this = static_cast<Thermostat_API*>(context);
+
+    while (1)
+    {
+        // Sleep until something changes. Any number of changes since the last pass are handled together
+        pthread_mutex_lock(&p_this->m_notify_mutex);
+        while (!p_this->m_notify_pending)
+        {
+            pthread_cond_wait(&p_this->m_notify_cond, &p_this->m_notify_mutex);
+        }
+        p_this->m_notify_pending = false;
+        pthread_mutex_unlock(&p_this->m_notify_mutex);
+
+        therm_event event;
+        event.status = p_this->get_therm_status();
+        event.err = p_this->get_therm_cont_err();
+        event.temp_valid = (therm_err_none == p_this->get_temp(event.temp));
+        therm_config config = p_this->get_therm_config();
+        event.mode = config.mode;
+        event.setpoint = config.setpoint;
+        event.margin = config.margin;
+
+        // Compare the latest state against what each subscriber last saw
+        pthread_mutex_lock(&p_this->m_subscriber_mutex);
+        for (size_t i = 0; i < p_this->m_subscribers.size(); i++)
+        {
+            therm_subscriber& sub = p_this->m_subscribers[i];
+            bool is_initial = sub.is_initial_pending;
+            sub.is_initial_pending = false;
+            event.type = is_initial ? therm_event_initial : 0;
+            if ((sub.event_mask & therm_event_status) && (is_initial || (event.status != sub.last_status)))
+            {
+                event.type |= therm_event_status;
+                sub.last_status = event.status;
+            }
+            if ((sub.event_mask & therm_event_temp) && event.temp_valid
+                && (is_initial || !sub.has_temp || ((event.temp != sub.last_temp)
+                                      && (std::fabs(event.temp - sub.last_temp) >= sub.temp_delta))))
+            {
+                event.type |= therm_event_temp;
+                sub.last_temp = event.temp;
+                sub.has_temp = true;
+            }
+            if ((sub.event_mask & therm_event_err) && (is_initial || (event.err != sub.last_err)))
+            {
+                event.type |= therm_event_err;
+                sub.last_err = event.err;
+            }
+            if ((sub.event_mask & therm_event_settings)
+                && (is_initial || (event.mode != sub.last_mode) || (event.setpoint != sub.last_setpoint)
+                    || (event.margin != sub.last_margin)))
+            {
+                event.type |= therm_event_settings;
+                sub.last_mode = event.mode;
+                sub.last_setpoint = event.setpoint;
+                sub.last_margin = event.margin;
+            }
+            if (0 != event.type)
+            {
+                sub.callback(event, sub.context);
+            }
+        }
+        pthread_mutex_unlock(&p_this->m_subscriber_mutex);
     }
 }
 
+void Thermostat_API::notify_change()
+{
+    pthread_mutex_lock(&m_notify_mutex);
+    m_notify_pending = true;
+    pthread_cond_signal(&m_notify_cond);
+    pthread_mutex_unlock(&m_notify_mutex);
+}
+
 void Thermostat_API::start_UDP_server()
 {
     // Setup the UDP server socket
@@ -125,24 +402,30 @@ void Thermostat_API::start_heating()
 {
     // TODO: TURN ON THE HEATER HARDWARE
     m_therm_status = therm_status_heating;
+    notify_change();
 }
 
 void Thermostat_API::stop_heating()
 {
     // TODO: TURN OFF THE HEATER HARDWARE
     m_therm_status = therm_status_inactive;
+    release_load_slot();
+    notify_change();
 }
 
 void Thermostat_API::start_cooling()
 {
     // TODO: TURN ON THE AC HARDWARE
     m_therm_status = therm_status_cooling;
+    notify_change();
 }
 
 void Thermostat_API::stop_cooling()
 {
     // TODO: TURN OFF THE AC HARDWARE
     m_therm_status = therm_status_inactive;
+    release_load_slot();
+    notify_change();
 }
 
 therm_err Thermostat_API::get_temp(float& temp)
@@ -161,32 +444,57 @@ therm_err Thermostat_API::get_temp(float& temp)
 
 void Thermostat_API::set_temp_margin(float temp_margin)
 {
-    m_temp_margin = temp_margin;
+    therm_config config;
+    config.margin = temp_margin;
+    m_p_config_store->update_slot(m_config_slot, therm_config_field_margin, config);
+    notify_change();
 }
 
 float Thermostat_API::get_temp_margin()
 {
-    return m_temp_margin;
+    return get_therm_config().margin;
 }
 
 void Thermostat_API::set_temp_setpoint(float temp_setpoint)
 {
-    m_temp_setpoint = temp_setpoint;
+    therm_config config;
+    config.setpoint = temp_setpoint;
+    m_p_config_store->update_slot(m_config_slot, therm_config_field_setpoint, config);
+    notify_change();
 }
 
 float Thermostat_API::get_temp_setpoint()
 {
-    return m_temp_setpoint;
+    return get_therm_config().setpoint;
 }
 
 void Thermostat_API::set_therm_mode(therm_mode setting)
 {
-    m_therm_mode = setting;
+    therm_config config;
+    config.mode = setting;
+    m_p_config_store->update_slot(m_config_slot, therm_config_field_mode, config);
+    notify_change();
 }
 
 therm_mode Thermostat_API::get_therm_mode()
 {
-    return m_therm_mode;
+    return get_therm_config().mode;
+}
+
+therm_err Thermostat_API::set_therm_config(const therm_config& config)
+{
+    therm_err ret_err = m_p_config_store->update_slot(m_config_slot, therm_config_field_all, config);
+    if (therm_err_none == ret_err)
+    {
+        notify_change();
+    }
+    return ret_err;
+}
+
+therm_config Thermostat_API::get_therm_config()
+{
+    unsigned long version = 0;
+    return m_p_config_store->get_config(m_config_slot, version);
 }
 
 therm_status Thermostat_API::get_therm_status()
@@ -198,3 +506,171 @@ therm_err Thermostat_API::get_therm_cont_err()
 {
     return m_therm_cont_err;
 }
+
+void Thermostat_API::advertise_sample_rate()
+{
+    therm_config config = get_therm_config();
+    therm_status status = get_therm_status();
+
+    pthread_mutex_lock(&m_sample_mutex);
+    if (m_has_sensor_addr)
+    {
+        // Find the distance to the nearest temperature at which the controller would change what it's doing
+        float temp = m_last_sample_temp;
+        float distance = -1.0f;
+        if ((therm_status_heating == status) || (therm_status_cooling == status))
+        {
+            distance = std::fabs(temp - config.setpoint);
+        }
+        else
+        {
+            if ((therm_mode_heat == config.mode) || (therm_mode_auto == config.mode))
+            {
+                distance = std::fabs(temp - (config.setpoint - config.margin));
+            }
+            if ((therm_mode_cool == config.mode) || (therm_mode_auto == config.mode))
+            {
+                float cool_distance = std::fabs(temp - (config.setpoint + config.margin));
+                distance = (distance < 0.0f) ? cool_distance : std::min(distance, cool_distance);
+            }
+        }
+
+        // Report often enough to catch the crossing at the current rate of change. With no threshold
+        // (thermostat off) the sensor reports as slowly as allowed, and only large changes matter
+        uint32_t interval_ms = sample_interval_max_ms;
+        float deadband = (distance < 0.0f) ? config.margin : distance * sample_safety_factor;
+        if (distance >= 0.0f)
+        {
+            float time_to_threshold_ms = 1000.0f * distance / std::max(m_temp_rate, sample_min_temp_rate);
+            interval_ms = static_cast<uint32_t>(std::min(std::max(time_to_threshold_ms * sample_safety_factor,
+                                                                  static_cast<float>(sample_interval_min_ms)),
+                                                         static_cast<float>(sample_interval_max_ms)));
+        }
+
+        // Only advertise material changes, plus a periodic refresh in case an advertisement was lost
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        bool is_stale = (now - m_advert_time) >= std::chrono::milliseconds(sample_interval_max_ms);
+        bool is_changed = (4 * interval_ms < 3 * m_advert_interval_ms) || (2 * interval_ms > 3 * m_advert_interval_ms)
+                          || (deadband < 0.75f * m_advert_deadband) || (deadband > 1.5f * m_advert_deadband);
+        if (!m_has_advert || is_stale || is_changed)
+        {
+            therm_rate_msg msg;
+            msg.magic = therm_rate_msg_magic;
+            msg.interval_ms = interval_ms;
+            msg.deadband = deadband;
+            sendto(m_socket_ID, &msg, sizeof(msg), 0, (struct sockaddr*)&m_sensor_addr, sizeof(m_sensor_addr));
+            m_has_advert = true;
+            m_advert_interval_ms = interval_ms;
+            m_advert_deadband = deadband;
+            m_advert_time = now;
+        }
+    }
+    pthread_mutex_unlock(&m_sample_mutex);
+}
+
+bool Thermostat_API::acquire_load_slot(float deviation)
+{
+    return (nullptr == m_p_coordinator) || m_p_coordinator->request_start(m_coordinator_unit_ID, deviation);
+}
+
+void Thermostat_API::release_load_slot()
+{
+    if (nullptr != m_p_coordinator)
+    {
+        m_p_coordinator->release(m_coordinator_unit_ID);
+    }
+}
+
+void Thermostat_API::set_therm_cont_err(therm_err err)
+{
+    if (err != m_therm_cont_err)
+    {
+        m_therm_cont_err = err;
+        notify_change();
+    }
+}
+
+unsigned long Thermostat_API::get_rx_count()
+{
+    return m_rx_count;
+}
+
+unsigned long Thermostat_API::get_rx_reject_count()
+{
+    return m_rx_reject_count;
+}
+
+int Thermostat_API::subscribe(int event_mask, float temp_delta, therm_event_callback callback, void* context)
+{
+    therm_subscriber sub;
+    sub.event_mask = event_mask;
+    sub.temp_delta = temp_delta;
+    sub.callback = callback;
+    sub.context = context;
+    // Only changes from the current state are delivered, unless the current state was asked for
+    sub.is_initial_pending = (0 != (event_mask & therm_event_initial));
+    sub.last_status = get_therm_status();
+    sub.last_err = get_therm_cont_err();
+    sub.has_temp = (therm_err_none == get_temp(sub.last_temp));
+    therm_config config = get_therm_config();
+    sub.last_mode = config.mode;
+    sub.last_setpoint = config.setpoint;
+    sub.last_margin = config.margin;
+
+    pthread_mutex_lock(&m_subscriber_mutex);
+    sub.ID = m_next_subscription_ID++;
+    m_subscribers.push_back(sub);
+    pthread_mutex_unlock(&m_subscriber_mutex);
+    // The state may have changed (and been dispatched) since it was read above. Have the dispatcher
+    // compare the new subscriber against the current state
+    notify_change();
+    return sub.ID;
+}
+
+void Thermostat_API::unsubscribe(int subscription_ID)
+{
+    pthread_mutex_lock(&m_subscriber_mutex);
+    for (std::vector<therm_subscriber>::iterator it = m_subscribers.begin(); it != m_subscribers.end(); ++it)
+    {
+        if (subscription_ID == it->ID)
+        {
+            m_subscribers.erase(it);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_subscriber_mutex);
+}
+
+void Thermostat_API::set_load_coordinator(Therm_Load_Coordinator* p_coordinator)
+{
+    pthread_mutex_lock(&m_coordinator_mutex);
+    // Hand back anything held with the old coordinator, and leave it, before switching
+    if (nullptr != m_p_coordinator)
+    {
+        m_p_coordinator->unregister_unit(m_coordinator_unit_ID);
+    }
+    m_p_coordinator = p_coordinator;
+    if (nullptr != m_p_coordinator)
+    {
+        m_coordinator_unit_ID = m_p_coordinator->register_unit();
+
+        // A unit that is already running must be counted against the cap, or stop
+        if (therm_status_inactive != get_therm_status())
+        {
+            float current_temp = 0.0f;
+            float deviation = 0.0f;
+            if (therm_err_none == get_temp(current_temp))
+            {
+                deviation = std::fabs(current_temp - get_temp_setpoint());
+            }
+            if (!acquire_load_slot(deviation))
+            {
+                // Stop without releasing the load slot, so the zone keeps its place in the queue
+                // TODO: TURN OFF THE HEATER OR AC HARDWARE
+                m_therm_status = therm_status_inactive;
+                notify_change();
+            }
+        }
+    }
+    pthread_mutex_unlock(&m_coordinator_mutex);
+}
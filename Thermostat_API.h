@@ -1,3 +1,4 @@
+#pragma once
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,12 +8,18 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 // Track thermostat errors
 // TODO (future): Error handling counld be extended
 enum therm_err{
     therm_err_none = 0,
     therm_err_no_temp_data,
+    therm_err_bad_config,
 };
 
 // Thermostat modes of operation. Each will determine the 
@@ -32,11 +39,65 @@ enum therm_status{
     therm_status_cooling
 };
 
+// Thermostat settings. Always read and applied together as one snapshot, so the controller never
+// sees a mix of old and new settings
+struct therm_config{
+    therm_mode mode;
+    float setpoint;
+    float margin;
+};
+
+// Sampling rate advertisement sent back to a temperature sensor over the UDP channel. A sensor
+// that honors it only reports when the interval has passed, or sooner if the temperature has
+// changed by more than the deadband since its last report
+const uint32_t therm_rate_msg_magic = 0x54524154;
+struct therm_rate_msg{
+    uint32_t magic;             // therm_rate_msg_magic
+    uint32_t interval_ms;       // Report at least this often
+    float deadband;             // Report immediately if the temperature changes by more than this
+};
+
+class Therm_Load_Coordinator;
+class Therm_Config_Store;
+
+// Kinds of change notifications. Combine into a mask when subscribing
+enum therm_event_type{
+    therm_event_status = 0x1,
+    therm_event_temp = 0x2,
+    therm_event_err = 0x4,
+    therm_event_settings = 0x8,
+    therm_event_initial = 0x10      // Deliver the current state as the first notification, not only changes
+};
+
+// Change notification delivered to subscribers. Changes are coalesced, so the event always
+// carries the latest thermostat state rather than every intermediate value
+struct therm_event{
+    int type;               // Mask of the therm_event_type values that changed
+    therm_status status;
+    bool temp_valid;        // True once a temperature has been received
+    float temp;             // Only meaningful if temp_valid is true
+    therm_err err;
+    therm_mode mode;
+    float setpoint;
+    float margin;
+};
+
+// Subscriber callback. Called from the notification dispatcher thread, never from the
+// controller or UDP listener threads. Must not call subscribe or unsubscribe
+typedef void (*therm_event_callback)(const therm_event& event, void* context);
+
 class Thermostat_API {
 
 public:
 Thermostat_API();
 
+/// Create a thermostat whose settings live in a shared configuration store, so settings for many
+/// thermostats can be published together in one atomic update
+/// @param p_config_store   Shared configuration store. Must outlive the thermostat. If nullptr, or if
+///                         config_slot is out of range, the settings are kept in a private store instead
+/// @param config_slot      This thermostat's slot in the store
+Thermostat_API(Therm_Config_Store* p_config_store, int config_slot);
+
 ~Thermostat_API();
 
 /// Start the UDP server for listening to UDP temperature data messages
@@ -81,6 +142,16 @@ void set_therm_mode(therm_mode setting);
 /// @return             therm_mode thermostat mode of operation
 therm_mode get_therm_mode();
 
+/// Set the mode, setpoint and margin together. The controller sees either the old settings or the
+/// new ones, never a mix, which separate calls to the individual setters can't guarantee
+/// @param config       New settings
+/// @return             therm_err. None, or bad_config if the settings could not be applied
+therm_err set_therm_config(const therm_config& config);
+
+/// Return a consistent snapshot of the thermostat settings (mode, setpoint and margin)
+/// @return             therm_config current settings
+therm_config get_therm_config();
+
 /// Get the thermostat temperature control status. see therm_status for options
 /// @return             therm_status status of the temperature controlled (heating, cooling, inactive)
 therm_status get_therm_status();
@@ -89,6 +160,43 @@ therm_status get_therm_status();
 /// @return             therm_err thermostat controller error
 therm_err get_therm_cont_err();
 
+/// Get the number of temperature messages accepted by the UDP listener
+/// @return             unsigned long count of valid temperature messages received
+unsigned long get_rx_count();
+
+/// Get the number of messages discarded by the UDP listener because they were truncated,
+/// oversized, or did not contain a plausible temperature
+/// @return             unsigned long count of rejected messages
+unsigned long get_rx_reject_count();
+
+/// Subscribe to change notifications instead of polling the getters. Notifications are delivered
+/// from a dispatcher thread and coalesced, so a slow subscriber only sees the latest state and
+/// never holds up the controller or the UDP listener. With therm_event_initial in the mask, the first
+/// notification carries the current state (every subscribed type, plus therm_event_initial) so the
+/// subscriber doesn't have to read the getters, which could race with the first change
+/// @param event_mask   Mask of therm_event_type values to be notified about
+/// @param temp_delta   Minimum temperature change (since the last temperature notification)
+///                     before a therm_event_temp notification is delivered. 0 notifies every change
+/// @param callback     Function called with each notification
+/// @param context      void* context passed back to the callback
+/// @return             int subscription ID to pass to unsubscribe
+int subscribe(int event_mask, float temp_delta, therm_event_callback callback, void* context);
+
+/// Share heating/cooling capacity with other thermostats on the site. While a coordinator is set,
+/// the controller only starts heating or cooling once the coordinator grants a slot, and stops
+/// early if asked to yield its slot to other waiting zones. Waits for any controller tick in
+/// progress, so once this returns the previous coordinator is no longer used and may be destroyed.
+/// A thermostat that is already heating or cooling keeps running only if the new coordinator
+/// grants it a slot straight away. Otherwise it stops and queues for a slot like any other zone
+/// @param p_coordinator    Coordinator to use, or nullptr to stop using one
+/// @return                 Nothing (void)
+void set_load_coordinator(Therm_Load_Coordinator* p_coordinator);
+
+/// Remove a subscription. Once this returns, the callback will not be called again
+/// @param subscription_ID  ID returned by subscribe
+/// @return                 Nothing (void)
+void unsubscribe(int subscription_ID);
+
 private:
 /// Thread callback function.
 /// Thermostat controller function. Setermines what action the temperature controller must take 
@@ -107,6 +215,40 @@ static void* therm_controller(void* context);
 /// @return             void* to comply with thread callback function expectations
 static void* temp_UDP_listener(void* sock_UDP_ID);
 
+/// Thread callback function.
+/// Notification dispatcher function. Waits for state changes and delivers coalesced
+/// notifications to each subscriber whose filter matches the change
+/// @param context      void* context parameter so the context can be passed into the static thread
+///                     function, which will allow access to member functions and member variables
+/// @return             void* to comply with thread callback function expectations
+static void* notify_dispatcher(void* context);
+
+/// Wake the notification dispatcher. Cheap and non-blocking for the caller; repeated calls
+/// before the dispatcher runs are coalesced into a single pass
+/// @return             Nothing (void)
+void notify_change();
+
+/// Work out how often the temperature sensor needs to report, from how close the zone is to its next
+/// heating/cooling switching threshold and how fast the temperature is changing. Advertise it to the
+/// sensor if it differs materially from the last advertisement (or that is getting old)
+/// @return             Nothing (void)
+void advertise_sample_rate();
+
+/// Ask the load coordinator (if any) for permission to heat or cool. Caller must hold m_coordinator_mutex
+/// @param deviation    How far the temperature is from the setpoint
+/// @return             bool true if heating/cooling may start
+bool acquire_load_slot(float deviation);
+
+/// Release this thermostat's load coordinator slot (or its place in the queue), if any.
+/// Caller must hold m_coordinator_mutex
+/// @return             Nothing (void)
+void release_load_slot();
+
+/// Set the temperature controller error, notifying subscribers if it changed
+/// @param err          therm_err new controller error
+/// @return             Nothing (void)
+void set_therm_cont_err(therm_err err);
+
 /// Turn the heating device on. This is determined by the therm_controller thread callback
 /// start the device and set the status
 /// @return             Nothing (void)
@@ -127,18 +269,58 @@ void start_cooling();
 /// @return             Nothing (void)
 void stop_cooling();
 
+// Subscription state, tracking what was last delivered to the subscriber
+struct therm_subscriber{
+    int ID;
+    int event_mask;
+    float temp_delta;
+    therm_event_callback callback;
+    void* context;
+    therm_status last_status;
+    float last_temp;
+    bool has_temp;
+    therm_err last_err;
+    therm_mode last_mode;
+    float last_setpoint;
+    float last_margin;
+    bool is_initial_pending;        // Current state still to be delivered (therm_event_initial)
+};
+
 // Member variables
-therm_mode m_therm_mode;
 therm_status m_therm_status;
 int m_temp_port;
 int m_socket_ID;
 struct sockaddr_in m_server_addr, m_client_addr;
 float m_temp;
-float m_temp_margin;
-float m_temp_setpoint;
+Therm_Config_Store* m_p_config_store;
+std::unique_ptr<Therm_Config_Store> m_p_private_config_store;     // Only set when the settings aren't shared
+int m_config_slot;
+unsigned long m_config_version;
 bool m_is_temp_valid;
 pthread_t m_UDP_thread;
 pthread_t m_therm_thread;
 therm_err m_therm_cont_err;
+std::atomic<unsigned long> m_rx_count;
+std::atomic<unsigned long> m_rx_reject_count;
+pthread_t m_notify_thread;
+pthread_mutex_t m_notify_mutex;
+pthread_cond_t m_notify_cond;
+bool m_notify_pending;
+pthread_mutex_t m_subscriber_mutex;
+std::vector<therm_subscriber> m_subscribers;
+int m_next_subscription_ID;
+pthread_mutex_t m_coordinator_mutex;       // Held by the controller for each tick, and while changing coordinator
+Therm_Load_Coordinator* m_p_coordinator;
+int m_coordinator_unit_ID;
+pthread_mutex_t m_sample_mutex;
+struct sockaddr_in m_sensor_addr;
+bool m_has_sensor_addr;
+std::chrono::steady_clock::time_point m_last_sample_time;
+float m_last_sample_temp;
+float m_temp_rate;
+bool m_has_advert;
+uint32_t m_advert_interval_ms;
+float m_advert_deadband;
+std::chrono::steady_clock::time_point m_advert_time;
 
 };
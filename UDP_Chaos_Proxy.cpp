@@ -0,0 +1,275 @@
+#include <unistd.h>
+#include <sys/time.h>
+#include "UDP_Chaos_Proxy.h"
+
+// How long the relay thread blocks waiting for a client datagram before servicing held datagrams
+static const int relay_poll_ms = 5;
+
+// Longest a reordered datagram waits for a later datagram to overtake it
+static const int reorder_hold_ms = 50;
+
+// Largest datagram the proxy will relay
+static const size_t max_datagram_size = 512;
+
+UDP_Chaos_Proxy::UDP_Chaos_Proxy(int listen_port, int target_port, unsigned int seed)
+: m_listen_port(listen_port)
+, m_target_port(target_port)
+, m_socket_ID(-1)
+, m_upstream_socket_ID(-1)
+, m_config()
+, m_rng(seed)
+, m_reorder_copies(0)
+, m_has_reorder_slot(false)
+, m_running(false)
+, m_received(0)
+, m_forwarded(0)
+, m_dropped(0)
+, m_duplicated(0)
+, m_reordered(0)
+, m_delayed(0)
+, m_truncated(0)
+, m_garbled(0)
+{
+    pthread_mutex_init(&m_config_mutex, 0);
+    memset(&m_target_addr, '\0', sizeof(m_target_addr));
+    m_target_addr.sin_family = AF_INET;
+    m_target_addr.sin_port = htons(m_target_port);
+    m_target_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+}
+
+UDP_Chaos_Proxy::~UDP_Chaos_Proxy()
+{
+    stop();
+    pthread_mutex_destroy(&m_config_mutex);
+}
+
+bool UDP_Chaos_Proxy::start()
+{
+    if (m_running)
+    {
+        return true;
+    }
+
+    struct sockaddr_in listen_addr;
+    m_socket_ID = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket_ID < 0)
+    {
+        return false;
+    }
+    // Relay on a separate socket so traffic from the API is never mistaken for client traffic
+    m_upstream_socket_ID = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_upstream_socket_ID < 0)
+    {
+        close(m_socket_ID);
+        m_socket_ID = -1;
+        return false;
+    }
+
+    memset(&listen_addr, '\0', sizeof(listen_addr));
+    listen_addr.sin_family = AF_INET;
+    listen_addr.sin_port = htons(m_listen_port);
+    listen_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    if (0 != bind(m_socket_ID, (struct sockaddr*)&listen_addr, sizeof(listen_addr)))
+    {
+        close(m_socket_ID);
+        close(m_upstream_socket_ID);
+        m_socket_ID = -1;
+        m_upstream_socket_ID = -1;
+        return false;
+    }
+
+    // Use a short receive timeout so held back datagrams are released even when the client is idle
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = relay_poll_ms * 1000;
+    setsockopt(m_socket_ID, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    m_running = true;
+    pthread_create(&m_relay_thread, 0, relay_loop, (void*)this);
+    return true;
+}
+
+void UDP_Chaos_Proxy::stop()
+{
+    if (m_running)
+    {
+        m_running = false;
+        pthread_join(m_relay_thread, 0);
+        close(m_socket_ID);
+        close(m_upstream_socket_ID);
+        m_socket_ID = -1;
+        m_upstream_socket_ID = -1;
+        m_held.clear();
+        m_has_reorder_slot = false;
+    }
+}
+
+void UDP_Chaos_Proxy::set_config(const chaos_config& config)
+{
+    pthread_mutex_lock(&m_config_mutex);
+    m_config = config;
+    pthread_mutex_unlock(&m_config_mutex);
+}
+
+chaos_stats UDP_Chaos_Proxy::get_stats()
+{
+    chaos_stats stats;
+    stats.received = m_received;
+    stats.forwarded = m_forwarded;
+    stats.dropped = m_dropped;
+    stats.duplicated = m_duplicated;
+    stats.reordered = m_reordered;
+    stats.delayed = m_delayed;
+    stats.truncated = m_truncated;
+    stats.garbled = m_garbled;
+    return stats;
+}
+
+void UDP_Chaos_Proxy::reset_stats()
+{
+    m_received = 0;
+    m_forwarded = 0;
+    m_dropped = 0;
+    m_duplicated = 0;
+    m_reordered = 0;
+    m_delayed = 0;
+    m_truncated = 0;
+    m_garbled = 0;
+}
+
+void* UDP_Chaos_Proxy::relay_loop(void* context)
+{
+    UDP_Chaos_Proxy* p_this = static_cast<UDP_Chaos_Proxy*>(context);
+    char buffer[max_datagram_size];
+    struct sockaddr_in si_other;
+    socklen_t addr_size;
+
+    while (p_this->m_running)
+    {
+        addr_size = sizeof(si_other);
+        ssize_t length = recvfrom(p_this->m_socket_ID, buffer, sizeof(buffer), 0, (struct sockaddr*)& si_other, &addr_size);
+        if (length >= 0)
+        {
+            p_this->m_received++;
+            p_this->process_datagram(std::vector<char>(buffer, buffer + length));
+        }
+        p_this->release_held();
+    }
+    return 0;
+}
+
+void UDP_Chaos_Proxy::process_datagram(std::vector<char> payload)
+{
+    pthread_mutex_lock(&m_config_mutex);
+    chaos_config config = m_config;
+    pthread_mutex_unlock(&m_config_mutex);
+
+    if (roll(config.loss_rate))
+    {
+        m_dropped++;
+        return;
+    }
+
+    // Corrupt the payload before deciding how (and when) to deliver it
+    if (roll(config.garbage_rate))
+    {
+        for (size_t i = 0; i < payload.size(); i++)
+        {
+            payload[i] = static_cast<char>(m_rng() & 0xFF);
+        }
+        m_garbled++;
+    }
+    if ((payload.size() > 1) && roll(config.truncate_rate))
+    {
+        std::uniform_int_distribution<size_t> length_dist(1, payload.size() - 1);
+        payload.resize(length_dist(m_rng));
+        m_truncated++;
+    }
+
+    int copies = roll(config.duplicate_rate) ? 2 : 1;
+    if (2 == copies)
+    {
+        m_duplicated++;
+    }
+
+    if (roll(config.delay_rate))
+    {
+        m_delayed++;
+        held_datagram held;
+        held.payload = payload;
+        held.release_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.delay_ms);
+        for (int i = 0; i < copies; i++)
+        {
+            m_held.push_back(held);
+        }
+    }
+    else if (!m_has_reorder_slot && roll(config.reorder_rate))
+    {
+        // Hold this datagram back so the next one overtakes it
+        m_reordered++;
+        m_reorder_slot = payload;
+        m_reorder_copies = copies;
+        m_reorder_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(reorder_hold_ms);
+        m_has_reorder_slot = true;
+    }
+    else
+    {
+        for (int i = 0; i < copies; i++)
+        {
+            forward(payload);
+        }
+        // The held back datagram has now been overtaken. Release it
+        release_reorder_slot();
+    }
+}
+
+void UDP_Chaos_Proxy::release_held()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (std::deque<held_datagram>::iterator it = m_held.begin(); it != m_held.end(); )
+    {
+        if (it->release_time <= now)
+        {
+            forward(it->payload);
+            it = m_held.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    // Don't strand a reordered datagram if no later datagram arrives to overtake it
+    if (m_has_reorder_slot && (m_reorder_deadline <= now))
+    {
+        release_reorder_slot();
+    }
+}
+
+void UDP_Chaos_Proxy::release_reorder_slot()
+{
+    if (m_has_reorder_slot)
+    {
+        for (int i = 0; i < m_reorder_copies; i++)
+        {
+            forward(m_reorder_slot);
+        }
+        m_has_reorder_slot = false;
+    }
+}
+
+void UDP_Chaos_Proxy::forward(const std::vector<char>& payload)
+{
+    sendto(m_upstream_socket_ID, payload.data(), payload.size(), 0, (struct sockaddr*)&m_target_addr, sizeof(m_target_addr));
+    m_forwarded++;
+}
+
+bool UDP_Chaos_Proxy::roll(float rate)
+{
+    if (rate <= 0.0f)
+    {
+        return false;
+    }
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    return dist(m_rng) < rate;
+}
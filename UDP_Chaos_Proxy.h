@@ -0,0 +1,137 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+
+// Fault injection rates used by the chaos proxy. Each rate is a probability (0.0 - 1.0)
+// applied independently to every datagram received from the client
+struct chaos_config{
+    float loss_rate;        // Drop the datagram entirely
+    float duplicate_rate;   // Forward the datagram twice
+    float reorder_rate;     // Hold the datagram back and forward it after the next one
+    float delay_rate;       // Hold the datagram back for delay_ms before forwarding
+    int delay_ms;           // Delay applied to delayed datagrams
+    float truncate_rate;    // Forward only a prefix of the datagram (shorter than sent)
+    float garbage_rate;     // Replace the payload with random bytes
+};
+
+// Counters describing what the chaos proxy did to the traffic it relayed
+struct chaos_stats{
+    unsigned long received;
+    unsigned long forwarded;
+    unsigned long dropped;
+    unsigned long duplicated;
+    unsigned long reordered;
+    unsigned long delayed;
+    unsigned long truncated;
+    unsigned long garbled;
+};
+
+/// Local UDP stand-in that sits between the test client and the thermostat API UDP server.
+/// Datagrams received on the proxy port are relayed to the API port after applying the
+/// configured faults (loss, duplication, reordering, delay, truncation and garbage payloads)
+/// so the listener and controller can be exercised against a misbehaving sensor network
+class UDP_Chaos_Proxy {
+
+public:
+/// @param listen_port  Port the proxy listens on for client datagrams
+/// @param target_port  Port of the thermostat API UDP server to relay datagrams to
+/// @param seed         Seed for the fault injection random number generator
+UDP_Chaos_Proxy(int listen_port, int target_port, unsigned int seed);
+
+~UDP_Chaos_Proxy();
+
+/// Bind the proxy socket and start the relay thread
+/// @return             true if the proxy socket was bound and the thread started
+bool start();
+
+/// Stop the relay thread. Any held back datagrams are discarded
+/// @return             Nothing (void)
+void stop();
+
+/// Replace the fault injection rates. Takes effect for the next received datagram
+/// @param config       Fault injection rates
+/// @return             Nothing (void)
+void set_config(const chaos_config& config);
+
+/// Return a snapshot of the proxy counters
+/// @return             chaos_stats counters since the proxy was started (or last reset)
+chaos_stats get_stats();
+
+/// Reset the proxy counters to zero
+/// @return             Nothing (void)
+void reset_stats();
+
+private:
+// Datagram held back by the proxy (reordered or delayed) until its release time
+struct held_datagram{
+    std::vector<char> payload;
+    std::chrono::steady_clock::time_point release_time;
+};
+
+/// Thread callback function.
+/// Relay loop. Receives client datagrams, applies faults, and forwards them to the target port
+/// @param context      void* context parameter so the context can be passed into the static thread
+///                     function, which will allow access to member functions and member variables
+/// @return             void* to comply with thread callback function expectations
+static void* relay_loop(void* context);
+
+/// Apply the configured faults to a received datagram and forward or hold it back
+/// @param payload      Datagram payload received from the client
+/// @return             Nothing (void)
+void process_datagram(std::vector<char> payload);
+
+/// Forward any held back datagrams whose release time has passed
+/// @return             Nothing (void)
+void release_held();
+
+/// Forward the datagram held back for reordering, if there is one
+/// @return             Nothing (void)
+void release_reorder_slot();
+
+/// Send a payload to the target port
+/// @param payload      Datagram payload to forward
+/// @return             Nothing (void)
+void forward(const std::vector<char>& payload);
+
+/// Return true with the given probability
+/// @param rate         Probability (0.0 - 1.0)
+/// @return             bool whether the fault should be applied
+bool roll(float rate);
+
+// Member variables
+int m_listen_port;
+int m_target_port;
+int m_socket_ID;
+int m_upstream_socket_ID;
+struct sockaddr_in m_target_addr;
+pthread_t m_relay_thread;
+pthread_mutex_t m_config_mutex;
+chaos_config m_config;
+std::mt19937 m_rng;
+std::deque<held_datagram> m_held;
+std::vector<char> m_reorder_slot;
+int m_reorder_copies;
+std::chrono::steady_clock::time_point m_reorder_deadline;
+bool m_has_reorder_slot;
+std::atomic<bool> m_running;
+std::atomic<unsigned long> m_received;
+std::atomic<unsigned long> m_forwarded;
+std::atomic<unsigned long> m_dropped;
+std::atomic<unsigned long> m_duplicated;
+std::atomic<unsigned long> m_reordered;
+std::atomic<unsigned long> m_delayed;
+std::atomic<unsigned long> m_truncated;
+std::atomic<unsigned long> m_garbled;
+
+};
@@ -1,15 +1,33 @@
 #include "Thermostat_API.h"
+#include "UDP_Chaos_Proxy.h"
+#include "Therm_Agg_Node.h"
+#include "Therm_Load_Coordinator.h"
+#include "Therm_Config_Store.h"
 #include <iostream>
 #include <iomanip>
 #include <chrono>
 #include <thread>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <fstream>
+#include <cmath>
 
 // Global variables for the UDP socket. 
 int port_UDP = 1234;
 int socket_ID;
 struct sockaddr_in server_address;
+
+// Chaos proxy port. Messages sent here are relayed to the API with injected faults
+int port_UDP_proxy = 1235;
+struct sockaddr_in proxy_address;
 Thermostat_API* p_test_API = nullptr;
 
+// Shared configuration store. The test API uses slot 0, the other slots stand in for other zones
+const int test_config_slots = 1000;
+Therm_Config_Store* p_test_config_store = nullptr;
+
 /// Templated function to compare expected values vs. obtained values
 /// This function prints to the console (using the test name to identify the test)
 /// If the obtained value and expected value match, the test passes
@@ -51,6 +69,11 @@ void setup_UDP_client()
     server_address.sin_family = AF_INET;
     server_address.sin_port = htons(port_UDP);
     server_address.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    memset(&proxy_address, '\0', sizeof(proxy_address));
+    proxy_address.sin_family = AF_INET;
+    proxy_address.sin_port = htons(port_UDP_proxy);
+    proxy_address.sin_addr.s_addr = inet_addr("127.0.0.1");
 }
 
 /// Send a mock temperature message the the API
@@ -62,6 +85,119 @@ void send_UDP_temp(float temp_value)
     std::cout << "Information: temperature message sent from client" << std::endl;
 }
 
+/// Send a burst of mock temperature messages without logging each one
+/// @param temp_value   The temperature value to send in every message
+/// @param count        The number of messages to send
+/// @param address      The address to send to (API server or chaos proxy)
+/// @return             Nothing (void)
+void send_UDP_temp_burst(float temp_value, int count, const struct sockaddr_in& address)
+{
+    for (int i = 0; i < count; i++)
+    {
+        sendto(socket_ID, &temp_value, sizeof(float), 0, (struct sockaddr*)&address, sizeof(address));
+    }
+}
+
+// Records the change notifications delivered to a test subscriber
+struct event_recorder{
+    std::mutex mutex;
+    std::condition_variable cond;
+    int status_count = 0;
+    int temp_count = 0;
+    int err_count = 0;
+    therm_status last_status = therm_status_inactive;
+    float last_temp = 0.0f;
+    therm_err last_err = therm_err_none;
+};
+
+/// Subscription callback for the test subscriber. Records the notification and wakes any waiter
+/// @param event        The change notification
+/// @param context      event_recorder* to record into
+/// @return             Nothing (void)
+void record_event(const therm_event& event, void* context)
+{
+    event_recorder* p_recorder = static_cast<event_recorder*>(context);
+    std::lock_guard<std::mutex> lock(p_recorder->mutex);
+    if (event.type & therm_event_status)
+    {
+        p_recorder->status_count++;
+        p_recorder->last_status = event.status;
+    }
+    if (event.type & therm_event_temp)
+    {
+        p_recorder->temp_count++;
+        p_recorder->last_temp = event.temp;
+    }
+    if (event.type & therm_event_err)
+    {
+        p_recorder->err_count++;
+        p_recorder->last_err = event.err;
+    }
+    p_recorder->cond.notify_all();
+}
+
+/// Wait (without polling) for the recorder to be notified of a specific thermostat status
+/// @param recorder     The recorder the subscription delivers to
+/// @param status       The status to wait for
+/// @param timeout_ms   Longest time to wait
+/// @return             therm_status the last status delivered when the wait ended
+therm_status wait_for_status(event_recorder& recorder, therm_status status, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(recorder.mutex);
+    recorder.cond.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                           [&recorder, status] { return status == recorder.last_status; });
+    return recorder.last_status;
+}
+
+// Mock temperature sensor that honors the sampling rate advertised by the API
+struct sensor_client{
+    bool has_advert;
+    uint32_t interval_ms;
+    float deadband;
+    bool has_sent;
+    float last_sent_temp;
+    std::chrono::steady_clock::time_point last_sent_time;
+    int sent_count;
+};
+
+/// Receive any pending sampling rate advertisements from the API. The latest one wins
+/// @param sensor       The mock sensor to update
+/// @return             Nothing (void)
+void receive_UDP_rate(sensor_client& sensor)
+{
+    therm_rate_msg msg;
+    while (sizeof(msg) == recv(socket_ID, &msg, sizeof(msg), MSG_DONTWAIT))
+    {
+        if (therm_rate_msg_magic == msg.magic)
+        {
+            sensor.has_advert = true;
+            sensor.interval_ms = msg.interval_ms;
+            sensor.deadband = msg.deadband;
+        }
+    }
+}
+
+/// Take one temperature sample on the mock sensor. The sample is only sent to the API if the advertised
+/// interval has passed, or the temperature has changed by more than the advertised deadband
+/// @param sensor       The mock sensor
+/// @param temp_value   The sampled temperature
+/// @return             Nothing (void)
+void sensor_sample(sensor_client& sensor, float temp_value)
+{
+    receive_UDP_rate(sensor);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!sensor.has_advert || !sensor.has_sent
+        || (now - sensor.last_sent_time >= std::chrono::milliseconds(sensor.interval_ms))
+        || (std::fabs(temp_value - sensor.last_sent_temp) > sensor.deadband))
+    {
+        sendto(socket_ID, &temp_value, sizeof(float), 0, (struct sockaddr*)&server_address, sizeof(server_address));
+        sensor.has_sent = true;
+        sensor.last_sent_temp = temp_value;
+        sensor.last_sent_time = now;
+        sensor.sent_count++;
+    }
+}
+
 /// Test use cases when the thermostat is in heat mode
 /// Each test case will be described in the test description
 /// @param fail_count   Track the number of failed tests. Append to the count if a test fails
@@ -396,10 +532,948 @@ void test_boundary_cases(int& fail_count)
     std::cout << std::endl;
 }
 
+// Results of running a scripted temperature trace through the chaos proxy
+struct fault_script_result{
+    int segments;               // Scripted temperatures, each held for several controller ticks
+    int wrong_segments;         // Segments where the settled status was ever wrong
+    int status_samples;         // Status samples taken once each segment had settled
+    int wrong_samples;          // Samples where the status didn't match the scripted temperature
+    int transitions;            // Status transitions the controller made
+    int expected_transitions;   // Status transitions the script calls for
+    double controller_ticks;    // Controller ticks elapsed while the script ran
+};
+
+/// Stream a scripted temperature trace through the chaos proxy in heat mode (setpoint 70, margin 2).
+/// The trace crosses the heating start and stop thresholds in both directions. Each temperature is
+/// held for two controller ticks and streamed continuously, then the status is sampled and compared
+/// against what a fault free controller would do. The chaos proxy must already be running and
+/// configured with the faults to inject
+/// @return             fault_script_result controller decisions made under the faults
+fault_script_result run_fault_script()
+{
+    // Temperature and expected status. 69 is within margin, so the status depends on the history
+    const float script_temps[] = { 67.0f, 71.0f, 69.0f, 67.0f, 69.0f, 71.0f };
+    const therm_status script_status[] = { therm_status_heating, therm_status_inactive, therm_status_inactive,
+                                           therm_status_heating, therm_status_heating, therm_status_inactive };
+    const int segment_ms = 2000;
+    const int settle_ms = 1200;
+    const int send_period_ms = 5;
+
+    fault_script_result result = {};
+    result.segments = sizeof(script_temps) / sizeof(script_temps[0]);
+    result.expected_transitions = 4;
+
+    // Start from off, then count every status transition made while the script runs
+    p_test_API->set_therm_mode(therm_mode_off);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    event_recorder recorder;
+    int sub_ID = p_test_API->subscribe(therm_event_status, 0.0f, record_event, &recorder);
+    p_test_API->set_temp_setpoint(70.0f);
+    p_test_API->set_temp_margin(2.0f);
+    p_test_API->set_therm_mode(therm_mode_heat);
+
+    std::chrono::steady_clock::time_point script_start = std::chrono::steady_clock::now();
+    for (int segment = 0; segment < result.segments; segment++)
+    {
+        bool is_segment_wrong = false;
+        std::chrono::steady_clock::time_point segment_start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - segment_start < std::chrono::milliseconds(segment_ms))
+        {
+            send_UDP_temp_burst(script_temps[segment], 1, proxy_address);
+            if (std::chrono::steady_clock::now() - segment_start >= std::chrono::milliseconds(settle_ms))
+            {
+                result.status_samples++;
+                if (script_status[segment] != p_test_API->get_therm_status())
+                {
+                    result.wrong_samples++;
+                    is_segment_wrong = true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(send_period_ms));
+        }
+        result.wrong_segments += is_segment_wrong ? 1 : 0;
+    }
+    result.controller_ticks = std::chrono::duration<double>(std::chrono::steady_clock::now() - script_start).count();
+
+    p_test_API->unsubscribe(sub_ID);
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    result.transitions = recorder.status_count;
+    return result;
+}
+
+/// Print the controller decisions made while running a fault script
+/// @param name         Name of the fault scenario
+/// @param result       Result of the fault script
+/// @param stats        Chaos proxy counters for the run
+/// @return             Nothing (void)
+void print_fault_script_result(const std::string& name, const fault_script_result& result, const chaos_stats& stats)
+{
+    std::cout << "Information: " << name << ". Chaos proxy received " << stats.received << ", forwarded " << stats.forwarded
+              << ", dropped " << stats.dropped << ", duplicated " << stats.duplicated
+              << ", reordered " << stats.reordered << ", delayed " << stats.delayed
+              << ", truncated " << stats.truncated << ", garbled " << stats.garbled << std::endl;
+    int spurious_transitions = std::max(0, result.transitions - result.expected_transitions);
+    std::cout << "Information: " << name << ". " << result.wrong_segments << " of " << result.segments
+              << " segments settled wrong (" << result.wrong_samples << " of " << result.status_samples
+              << " samples), " << result.transitions << " transitions (" << result.expected_transitions
+              << " expected), " << std::fixed << std::setprecision(3)
+              << spurious_transitions / result.controller_ticks << " wrong decisions per controller tick" << std::endl;
+}
+
+/// Test the listener and controller against a misbehaving sensor network. Temperature messages are
+/// relayed through a chaos proxy which drops, duplicates, reorders, delays, truncates and corrupts
+/// them while a scripted trace crosses the switching thresholds over several controller ticks.
+/// Wrong controller decisions are counted, and the listener's ingest throughput is measured
+/// separately with an unpaced flood
+/// @param fail_count   Track the number of failed tests. Append to the count if a test fails
+/// @return             Nothing (void)
+void test_fault_injection(int& fail_count)
+{
+    std::cout << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << "Fault Injection Test Cases" << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << std::endl;
+    if (nullptr != p_test_API)
+    {
+        UDP_Chaos_Proxy proxy(port_UDP_proxy, port_UDP, 1234u);
+        bool proxy_started = proxy.start();
+        fail_count += test_result(proxy_started, true, "Start the chaos proxy. Verify it is running");
+        if (!proxy_started)
+        {
+            return;
+        }
+
+        // Network faults: loss, duplication, reordering, delay and truncation. Truncated messages are
+        // rejected and the rest still carry the right temperature, so every decision should be right
+        chaos_config config = {};
+        config.loss_rate = 0.1f;
+        config.duplicate_rate = 0.1f;
+        config.reorder_rate = 0.1f;
+        config.delay_rate = 0.1f;
+        config.delay_ms = 20;
+        config.truncate_rate = 0.2f;
+        proxy.set_config(config);
+        proxy.reset_stats();
+        unsigned long reject_before = p_test_API->get_rx_reject_count();
+        fault_script_result network_result = run_fault_script();
+        chaos_stats network_stats = proxy.get_stats();
+        print_fault_script_result("Network faults", network_result, network_stats);
+        fail_count += test_result(p_test_API->get_rx_reject_count() > reject_before, true,
+                                   "Network faults. Truncated messages sent. Verify the listener rejects them");
+        fail_count += test_result(network_result.wrong_samples, 0,
+                                   "Network faults. Trace crosses the thresholds. Verify every settled status is right");
+        fail_count += test_result(network_result.transitions, network_result.expected_transitions,
+                                   "Network faults. Trace crosses the thresholds. Verify no spurious transitions");
+
+        // Add garbage payloads. Some random payloads decode to a plausible temperature and can't be told
+        // apart from real readings, so this measures how far the controller degrades
+        config.garbage_rate = 0.2f;
+        proxy.set_config(config);
+        proxy.reset_stats();
+        fault_script_result garbage_result = run_fault_script();
+        print_fault_script_result("Network faults and garbage", garbage_result, proxy.get_stats());
+        fail_count += test_result(garbage_result.status_samples > 0, true,
+                                   "Network faults and garbage. Verify the controller was sampled under faults");
+
+        // A single clean reading must restore normal operation after the faults
+        proxy.stop();
+        send_UDP_temp(67.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating,
+                                   "Heat mode enabled. Clean reading after faults. Verify the thermostat is heating");
+
+        // Ingest throughput: flood the listener directly, unpaced, with a mix of valid and truncated
+        // messages. Time from the first to the last message the listener handled. The listener only logs
+        // a summary once a second, so this measures ingest rather than console output
+        const int flood_count = 20000;
+        unsigned long handled_before = p_test_API->get_rx_count() + p_test_API->get_rx_reject_count();
+        std::thread flood_sender([flood_count]()
+        {
+            float temp_value = 67.0f;
+            for (int i = 0; i < flood_count; i++)
+            {
+                size_t length = (0 == (i % 4)) ? 2 : sizeof(float);
+                sendto(socket_ID, &temp_value, length, 0, (struct sockaddr*)&server_address, sizeof(server_address));
+            }
+        });
+        unsigned long handled = handled_before;
+        std::chrono::steady_clock::time_point first_time = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point last_time = first_time;
+        bool has_first = false;
+        while (std::chrono::steady_clock::now() - last_time < std::chrono::milliseconds(200))
+        {
+            unsigned long current = p_test_API->get_rx_count() + p_test_API->get_rx_reject_count();
+            if (current != handled)
+            {
+                if (!has_first)
+                {
+                    first_time = std::chrono::steady_clock::now();
+                    has_first = true;
+                    handled_before = handled;
+                }
+                handled = current;
+                last_time = std::chrono::steady_clock::now();
+            }
+            // Poll gently so the receiver isn't competing with this loop for the CPU
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        flood_sender.join();
+        double flood_s = std::chrono::duration<double>(last_time - first_time).count();
+        unsigned long flood_handled = handled - handled_before;
+        std::cout << "Information: unpaced flood of " << flood_count << " messages. Listener handled "
+                  << flood_handled << " (the rest were dropped before reaching the listener) at " << std::fixed << std::setprecision(0)
+                  << ((flood_s > 0.0) ? flood_handled / flood_s : 0.0) << " messages/s" << std::endl;
+        fail_count += test_result(has_first, true, "Unpaced flood. Verify the listener handled messages");
+
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive,
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+    }
+    std::cout << std::endl;
+}
+
+/// Test change notification subscriptions. Status transitions are awaited through the subscription
+/// rather than by sleeping and polling the getters
+/// @param fail_count   Track the number of failed tests. Append to the count if a test fails
+/// @return             Nothing (void)
+void test_subscriptions(int& fail_count)
+{
+    std::cout << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << "Subscription Test Cases" << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << std::endl;
+    if (nullptr != p_test_API)
+    {
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+
+        event_recorder recorder;
+        int sub_ID = p_test_API->subscribe(therm_event_status | therm_event_temp | therm_event_err, 1.0f,
+                                           record_event, &recorder);
+
+        // Drop below setpoint and margin. The heating transition is delivered to the subscriber
+        p_test_API->set_temp_setpoint(70.0f);
+        p_test_API->set_temp_margin(2.0f);
+        send_UDP_temp(67.0f);
+        p_test_API->set_therm_mode(therm_mode_heat);
+        fail_count += test_result(wait_for_status(recorder, therm_status_heating, 2000), therm_status_heating, 
+                                   "Subscribed. Heat mode enabled. Below setpoint and margin. Verify heating is notified");
+
+        // A temperature change smaller than the subscription delta is not notified
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        int temp_count = 0;
+        {
+            std::lock_guard<std::mutex> lock(recorder.mutex);
+            temp_count = recorder.temp_count;
+        }
+        send_UDP_temp(67.5f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        {
+            std::lock_guard<std::mutex> lock(recorder.mutex);
+            fail_count += test_result(recorder.temp_count, temp_count, 
+                                       "Subscribed. Temperature change below delta. Verify it is not notified");
+        }
+
+        // A temperature change of at least the subscription delta is notified with the latest value
+        send_UDP_temp(68.5f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        {
+            std::lock_guard<std::mutex> lock(recorder.mutex);
+            fail_count += test_result(recorder.temp_count, temp_count + 1, 
+                                       "Subscribed. Temperature change above delta. Verify it is notified");
+            fail_count += test_result(recorder.last_temp, 68.5f, 
+                                       "Subscribed. Temperature change above delta. Verify the latest temperature is notified");
+            fail_count += test_result(recorder.last_err, therm_err_none, 
+                                       "Subscribed. Temperature received. Verify no controller error");
+        }
+
+        // Rise above setpoint. The transition back to inactive is delivered to the subscriber
+        send_UDP_temp(70.5f);
+        fail_count += test_result(wait_for_status(recorder, therm_status_inactive, 2000), therm_status_inactive, 
+                                   "Subscribed. Heat mode enabled. Above setpoint. Verify inactive is notified");
+
+        // After unsubscribing, no more notifications are delivered
+        p_test_API->unsubscribe(sub_ID);
+        int status_count = 0;
+        {
+            std::lock_guard<std::mutex> lock(recorder.mutex);
+            status_count = recorder.status_count;
+        }
+        send_UDP_temp(67.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating, 
+                                   "Unsubscribed. Below setpoint and margin. Verify the thermostat is heating");
+        {
+            std::lock_guard<std::mutex> lock(recorder.mutex);
+            fail_count += test_result(recorder.status_count, status_count, 
+                                       "Unsubscribed. Status changed. Verify it is not notified");
+        }
+
+        // Subscribe repeatedly while the controller switches from heating to inactive. Every subscriber
+        // asks for the current state first, so each one's view is known. Whenever a subscriber was
+        // added relative to the transition, it must end up seeing the current status
+        const int race_sub_count = 60;
+        event_recorder race_recorders[race_sub_count];
+        int race_sub_IDs[race_sub_count];
+        send_UDP_temp(70.5f);
+        for (int i = 0; i < race_sub_count; i++)
+        {
+            race_sub_IDs[i] = p_test_API->subscribe(therm_event_status | therm_event_initial, 0.0f,
+                                                    record_event, &race_recorders[i]);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Subscribing during a transition. Above setpoint. Verify the thermostat is inactive");
+        int stale_count = 0;
+        for (int i = 0; i < race_sub_count; i++)
+        {
+            p_test_API->unsubscribe(race_sub_IDs[i]);
+            std::lock_guard<std::mutex> lock(race_recorders[i].mutex);
+            if ((0 == race_recorders[i].status_count) || (therm_status_inactive != race_recorders[i].last_status))
+            {
+                stale_count++;
+            }
+        }
+        fail_count += test_result(stale_count, 0, 
+                                   "Subscribing during a transition. Verify no subscriber is left on the old status");
+
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+    }
+    std::cout << std::endl;
+}
+
+/// Test aggregation of zones into floors, buildings and a site. Synthetic zones are updated directly,
+/// and the test API is attached as a live zone through its change notifications
+/// @param fail_count   Track the number of failed tests. Append to the count if a test fails
+/// @return             Nothing (void)
+void test_aggregation(int& fail_count)
+{
+    std::cout << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << "Aggregation Test Cases" << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << std::endl;
+    if (nullptr != p_test_API)
+    {
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+
+        // Site -> building -> two floors. Floor 1 has two synthetic zones, floor 2 has one plus the test API
+        Therm_Agg_Node site(nullptr);
+        Therm_Agg_Node building(&site);
+        Therm_Agg_Node floor_1(&building);
+        Therm_Agg_Node floor_2(&building);
+        int zone_a = floor_1.add_zone();
+        int zone_b = floor_1.add_zone();
+        int zone_c = floor_2.add_zone();
+        p_test_API->set_temp_setpoint(70.0f);
+        p_test_API->set_temp_margin(2.0f);
+        send_UDP_temp(70.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        floor_2.attach_zone(p_test_API);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        fail_count += test_result(floor_2.get_summary().temp_count, 1, 
+                                   "Aggregation. Attached a live zone. Verify its initial state is delivered");
+
+        floor_1.update_zone(zone_a, therm_status_heating, true, 66.0f, 70.0f);
+        floor_1.update_zone(zone_b, therm_status_inactive, true, 71.0f, 70.0f);
+        floor_2.update_zone(zone_c, therm_status_cooling, true, 77.0f, 72.0f);
+        therm_agg_summary summary = site.get_summary();
+        fail_count += test_result(summary.zone_count, 4, "Aggregation. Verify the site zone count");
+        fail_count += test_result(summary.heating_count, 1, "Aggregation. Verify the site heating count");
+        fail_count += test_result(summary.cooling_count, 1, "Aggregation. Verify the site cooling count");
+        fail_count += test_result(summary.avg_temp, 71.0f, "Aggregation. Verify the site average temperature");
+        fail_count += test_result(summary.worst_deviation, 5.0f, "Aggregation. Verify the site worst deviation");
+        fail_count += test_result(floor_1.get_summary().worst_deviation, 4.0f, 
+                                   "Aggregation. Verify the floor worst deviation");
+
+        // Bring the worst zone back to its setpoint. The next worst zone (on another floor) takes over
+        floor_2.update_zone(zone_c, therm_status_inactive, true, 72.0f, 72.0f);
+        summary = site.get_summary();
+        fail_count += test_result(summary.cooling_count, 0, "Aggregation. Worst zone recovered. Verify the site cooling count");
+        fail_count += test_result(summary.worst_deviation, 4.0f, 
+                                   "Aggregation. Worst zone recovered. Verify the site worst deviation");
+
+        // The live zone starts heating. The change reaches the site through its subscription
+        send_UDP_temp(67.0f);
+        p_test_API->set_therm_mode(therm_mode_heat);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        summary = site.get_summary();
+        fail_count += test_result(summary.heating_count, 2, "Aggregation. Live zone heating. Verify the site heating count");
+        fail_count += test_result(building.get_summary().avg_temp, 69.0f, 
+                                   "Aggregation. Live zone heating. Verify the building average temperature");
+
+        // Removing a floor removes its zones from the site
+        {
+            Therm_Agg_Node floor_3(&building);
+            floor_3.update_zone(floor_3.add_zone(), therm_status_cooling, true, 90.0f, 70.0f);
+            fail_count += test_result(site.get_summary().worst_deviation, 20.0f, 
+                                       "Aggregation. Floor added. Verify the site worst deviation");
+        }
+        fail_count += test_result(site.get_summary().zone_count, 4, "Aggregation. Floor removed. Verify the site zone count");
+        fail_count += test_result(site.get_summary().worst_deviation, 4.0f, 
+                                   "Aggregation. Floor removed. Verify the site worst deviation");
+
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+        fail_count += test_result(site.get_summary().heating_count, 1, 
+                                   "Aggregation. Live zone off. Verify the site heating count");
+
+        // Benchmark incremental rollups on a 10k zone site (10 buildings x 10 floors x 100 zones)
+        Therm_Agg_Node big_site(nullptr);
+        std::vector<Therm_Agg_Node*> buildings;
+        std::vector<Therm_Agg_Node*> floors;
+        std::vector<std::pair<Therm_Agg_Node*, int> > zones;
+        for (int b = 0; b < 10; b++)
+        {
+            buildings.push_back(new Therm_Agg_Node(&big_site));
+            for (int f = 0; f < 10; f++)
+            {
+                floors.push_back(new Therm_Agg_Node(buildings.back()));
+                for (int z = 0; z < 100; z++)
+                {
+                    zones.push_back(std::make_pair(floors.back(), floors.back()->add_zone()));
+                }
+            }
+        }
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> zone_dist(0, zones.size() - 1);
+        std::uniform_int_distribution<int> status_dist(0, 2);
+        std::uniform_real_distribution<float> temp_dist(60.0f, 80.0f);
+        const int update_count = 200000;
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        for (int i = 0; i < update_count; i++)
+        {
+            std::pair<Therm_Agg_Node*, int>& zone = zones[zone_dist(rng)];
+            zone.first->update_zone(zone.second, static_cast<therm_status>(status_dist(rng)), true, temp_dist(rng), 70.0f);
+        }
+        double update_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+        const int query_count = 200000;
+        float checksum = 0.0f;
+        start_time = std::chrono::steady_clock::now();
+        for (int i = 0; i < query_count; i++)
+        {
+            checksum += big_site.get_summary().worst_deviation;
+        }
+        double query_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "Information: 10k zone site. " << std::fixed << std::setprecision(0)
+                  << update_ns / update_count << " ns per zone update, "
+                  << query_ns / query_count << " ns per site summary query" << std::endl;
+
+        // Compare the incremental rollup against a full scan of the zones
+        int scan_heating = 0;
+        for (size_t i = 0; i < floors.size(); i++)
+        {
+            scan_heating += floors[i]->get_summary().heating_count;
+        }
+        fail_count += test_result(big_site.get_summary().heating_count, scan_heating, 
+                                   "Aggregation. 10k zone site. Verify the site rollup matches the floors");
+        fail_count += test_result(big_site.get_summary().zone_count, 10000, 
+                                   "Aggregation. 10k zone site. Verify the site zone count");
+
+        for (size_t i = 0; i < floors.size(); i++)
+        {
+            delete floors[i];
+        }
+        for (size_t i = 0; i < buildings.size(); i++)
+        {
+            delete buildings[i];
+        }
+        fail_count += test_result(big_site.get_summary().zone_count, 0, 
+                                   "Aggregation. 10k zone site torn down. Verify the site is empty");
+    }
+    std::cout << std::endl;
+}
+
+// Results of a synthetic demand-response trace
+struct load_sim_result{
+    int peak_active;
+    float worst_deviation;      // Largest setpoint - temperature seen after the morning warm-up starts
+    unsigned long op_count;     // Coordinator calls made
+    double elapsed_ns;          // Time spent running the trace
+};
+
+/// Run a synthetic heating trace through a load coordinator. Each zone follows the same heating logic
+/// as the thermostat controller. Setpoints step from a night setback to the day setpoint on the same
+/// tick for every zone, which is the synchronised start that causes peak demand spikes
+/// @param coordinator  The coordinator to run the trace through
+/// @param zone_count   Number of zones
+/// @param tick_count   Number of controller ticks to simulate
+/// @return             load_sim_result peak demand, comfort and cost of the trace
+load_sim_result run_load_simulation(Therm_Load_Coordinator& coordinator, int zone_count, int tick_count)
+{
+    const float night_setpoint = 66.0f;
+    const float day_setpoint = 70.0f;
+    const int warm_up_tick = 50;
+    const float margin = 1.0f;
+    const float heat_gain = 0.4f;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> start_dist(night_setpoint - margin, night_setpoint + margin);
+    std::uniform_real_distribution<float> loss_dist(0.02f, 0.08f);
+    std::vector<int> unit_IDs(zone_count);
+    std::vector<float> temps(zone_count);
+    std::vector<bool> is_heating(zone_count, false);
+    for (int i = 0; i < zone_count; i++)
+    {
+        unit_IDs[i] = coordinator.register_unit();
+        temps[i] = start_dist(rng);
+    }
+
+    load_sim_result result = {};
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < tick_count; tick++)
+    {
+        float setpoint = (tick < warm_up_tick) ? night_setpoint : day_setpoint;
+        int active = 0;
+        for (int i = 0; i < zone_count; i++)
+        {
+            if (is_heating[i])
+            {
+                result.op_count++;
+                if ((temps[i] >= setpoint) || coordinator.should_yield(unit_IDs[i]))
+                {
+                    is_heating[i] = false;
+                    coordinator.release(unit_IDs[i]);
+                    result.op_count++;
+                }
+            }
+            else if (temps[i] < setpoint - margin)
+            {
+                is_heating[i] = coordinator.request_start(unit_IDs[i], setpoint - temps[i]);
+                result.op_count++;
+            }
+            else
+            {
+                coordinator.release(unit_IDs[i]);
+                result.op_count++;
+            }
+
+            temps[i] += is_heating[i] ? heat_gain : -loss_dist(rng);
+            active += is_heating[i] ? 1 : 0;
+            if (tick >= warm_up_tick)
+            {
+                result.worst_deviation = std::max(result.worst_deviation, setpoint - temps[i]);
+            }
+        }
+        result.peak_active = std::max(result.peak_active, active);
+    }
+    result.elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+    return result;
+}
+
+/// Test the demand-response load coordinator. A live thermostat must wait for a slot when the site is at
+/// its cap, and a synthetic trace shows the peak demand reduction across many zones
+/// @param fail_count   Track the number of failed tests. Append to the count if a test fails
+/// @return             Nothing (void)
+void test_load_coordinator(int& fail_count)
+{
+    std::cout << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << "Load Coordinator Test Cases" << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << std::endl;
+    if (nullptr != p_test_API)
+    {
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+
+        // A site with room for one active unit, already taken by another zone
+        Therm_Load_Coordinator coordinator(1, 0);
+        p_test_API->set_load_coordinator(&coordinator);
+        int other_unit = coordinator.register_unit();
+        fail_count += test_result(coordinator.request_start(other_unit, 5.0f), true, 
+                                   "Load cap of one. Verify the first unit is granted a slot");
+
+        // Below setpoint and margin, but no slot is free. Verify the thermostat waits
+        p_test_API->set_temp_setpoint(70.0f);
+        p_test_API->set_temp_margin(2.0f);
+        send_UDP_temp(67.0f);
+        p_test_API->set_therm_mode(therm_mode_heat);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Load cap reached. Below setpoint and margin. Verify the thermostat is inactive");
+        fail_count += test_result(coordinator.get_waiting_count(), 1, 
+                                   "Load cap reached. Below setpoint and margin. Verify the thermostat is waiting");
+
+        // The other unit stops. Its slot is handed to the waiting thermostat
+        coordinator.release(other_unit);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating, 
+                                   "Load slot released. Below setpoint and margin. Verify the thermostat is heating");
+        fail_count += test_result(coordinator.get_active_count(), 1, 
+                                   "Load slot released. Verify one unit is active");
+
+        // Turn the thermostat off, wait for the controller thread, then verify it's off and released its slot
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+        fail_count += test_result(coordinator.get_active_count(), 0, 
+                                   "Thermostat off. Verify the load slot was released");
+        p_test_API->set_load_coordinator(nullptr);
+        fail_count += test_result(coordinator.get_unit_count(), 1, 
+                                   "Thermostat detached. Verify it unregistered from the coordinator");
+
+        // Attaching and detaching repeatedly reuses the same unit instead of growing the coordinator
+        for (int i = 0; i < 10; i++)
+        {
+            p_test_API->set_load_coordinator(&coordinator);
+            p_test_API->set_load_coordinator(nullptr);
+        }
+        fail_count += test_result(coordinator.get_unit_count(), 1, 
+                                   "Thermostat attached and detached repeatedly. Verify no units are left behind");
+
+        // Unregistering an active unit hands its slot to the front of the queue, and unregistering a
+        // waiting unit takes it out of the queue
+        int active_unit = coordinator.register_unit();
+        int waiting_unit = coordinator.register_unit();
+        int queued_unit = coordinator.register_unit();
+        coordinator.request_start(active_unit, 1.0f);
+        coordinator.request_start(waiting_unit, 3.0f);
+        coordinator.request_start(queued_unit, 2.0f);
+        coordinator.unregister_unit(active_unit);
+        fail_count += test_result(coordinator.request_start(waiting_unit, 3.0f), true, 
+                                   "Active unit unregistered. Verify its slot goes to the most urgent waiter");
+        coordinator.unregister_unit(queued_unit);
+        fail_count += test_result(coordinator.get_waiting_count(), 0, 
+                                   "Waiting unit unregistered. Verify it left the queue");
+        fail_count += test_result(coordinator.register_unit(), queued_unit, 
+                                   "Unit unregistered. Verify its ID is reused");
+
+        // Heat without a coordinator, then attach to a site that is already at its cap
+        send_UDP_temp(67.0f);
+        p_test_API->set_therm_mode(therm_mode_heat);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating, 
+                                   "No load coordinator. Below setpoint and margin. Verify the thermostat is heating");
+        Therm_Load_Coordinator full_site(1, 0);
+        int full_site_unit = full_site.register_unit();
+        full_site.request_start(full_site_unit, 5.0f);
+        p_test_API->set_load_coordinator(&full_site);
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Heating thermostat attached to a full site. Verify it stops straight away");
+        fail_count += test_result(full_site.get_active_count(), 1, 
+                                   "Heating thermostat attached to a full site. Verify the cap is respected");
+        fail_count += test_result(full_site.get_waiting_count(), 1, 
+                                   "Heating thermostat attached to a full site. Verify it queues for a slot straight away");
+
+        // Another zone just as far from its setpoint queues afterwards. The thermostat keeps its place
+        // ahead of it across controller ticks, and is granted the slot first
+        int late_unit = full_site.register_unit();
+        full_site.request_start(late_unit, 3.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        full_site.release(full_site_unit);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating, 
+                                   "Full site slot released. Verify the attached thermostat is heating");
+        fail_count += test_result(full_site.get_waiting_count(), 1, 
+                                   "Full site slot released. Verify the zone that queued later is still waiting");
+        full_site.release(late_unit);
+
+        // Move the heating thermostat to a site with a free slot. It keeps running and is counted
+        Therm_Load_Coordinator free_site(1, 0);
+        p_test_API->set_load_coordinator(&free_site);
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating, 
+                                   "Heating thermostat attached to a site with a free slot. Verify it keeps heating");
+        fail_count += test_result(free_site.get_active_count(), 1, 
+                                   "Heating thermostat attached to a site with a free slot. Verify it is counted as active");
+        fail_count += test_result(full_site.get_active_count(), 0, 
+                                   "Heating thermostat moved to another site. Verify its old slot was released");
+
+        // Turn the thermostat off, wait for the controller thread, then verify it's off and released its slot
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+        fail_count += test_result(free_site.get_active_count(), 0, 
+                                   "Thermostat off. Verify the load slot was released");
+        p_test_API->set_load_coordinator(nullptr);
+
+        // Synthetic trace: 2000 zones all warming up from a night setback on the same tick
+        const int zone_count = 2000;
+        const int tick_count = 300;
+        const int load_cap = zone_count / 4;
+        Therm_Load_Coordinator uncapped(zone_count, 0);
+        Therm_Load_Coordinator capped(load_cap, 10);
+        load_sim_result uncapped_result = run_load_simulation(uncapped, zone_count, tick_count);
+        load_sim_result capped_result = run_load_simulation(capped, zone_count, tick_count);
+        std::cout << "Information: uncapped peak " << uncapped_result.peak_active << " active units, worst deviation "
+                  << std::fixed << std::setprecision(2) << uncapped_result.worst_deviation << std::endl;
+        std::cout << "Information: capped peak " << capped_result.peak_active << " active units, worst deviation "
+                  << std::fixed << std::setprecision(2) << capped_result.worst_deviation << ", "
+                  << std::setprecision(0) << capped_result.elapsed_ns / capped_result.op_count
+                  << " ns per coordinator call" << std::endl;
+
+        fail_count += test_result(uncapped_result.peak_active > load_cap, true, 
+                                   "Synthetic trace. Uncapped. Verify the warm-up causes a demand spike above the cap");
+        fail_count += test_result(capped_result.peak_active <= load_cap, true, 
+                                   "Synthetic trace. Capped. Verify peak demand never exceeds the cap");
+        fail_count += test_result(capped.get_peak_active() <= load_cap, true, 
+                                   "Synthetic trace. Capped. Verify the coordinator never granted more than the cap");
+    }
+    std::cout << std::endl;
+}
+
+// Shared state for the configuration reload stress test
+struct config_stress_state{
+    std::atomic<bool> running;
+    std::atomic<unsigned long> reads;
+    std::atomic<unsigned long> torn_reads;
+};
+
+/// Reader thread for the configuration reload stress test. Repeatedly reads every slot from one
+/// snapshot and counts snapshots that mix settings from different publishes
+/// @param p_state      Shared stress test state
+/// @return             Nothing (void)
+void config_stress_reader(config_stress_state* p_state)
+{
+    while (p_state->running)
+    {
+        Therm_Config_Reader reader(*p_test_config_store);
+        const therm_config_table& table = reader.get_table();
+        const therm_config& first = table.configs[1];
+        for (size_t i = 1; i < table.configs.size(); i++)
+        {
+            const therm_config& config = table.configs[i];
+            if ((config.mode != first.mode) || (config.setpoint != first.setpoint) || (config.margin != first.margin)
+                || ((therm_mode_heat == config.mode) != (70.0f == config.setpoint)))
+            {
+                p_state->torn_reads++;
+                break;
+            }
+        }
+        p_state->reads++;
+    }
+}
+
+/// Test bulk configuration reloads. Settings for many zones are published in one atomic update, from
+/// memory or from a file, and readers never see a mix of old and new settings
+/// @param fail_count   Track the number of failed tests. Append to the count if a test fails
+/// @return             Nothing (void)
+void test_config_reload(int& fail_count)
+{
+    std::cout << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << "Configuration Reload Test Cases" << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << std::endl;
+    if ((nullptr != p_test_API) && (nullptr != p_test_config_store))
+    {
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+
+        // Publish heat mode, setpoint and margin for every zone in one update
+        therm_config heat_config = { therm_mode_heat, 70.0f, 2.0f };
+        std::vector<therm_config> configs(test_config_slots, heat_config);
+        send_UDP_temp(67.0f);
+        fail_count += test_result(p_test_config_store->publish(configs), therm_err_none, 
+                                   "Bulk publish. Verify the settings are accepted");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating, 
+                                   "Bulk publish heat mode. Below setpoint and margin. Verify the thermostat is heating");
+        fail_count += test_result(p_test_API->get_temp_setpoint(), 70.0f, 
+                                   "Bulk publish heat mode. Verify the setpoint getter sees the published setpoint");
+
+        // A settings table with the wrong number of zones is rejected as a whole
+        fail_count += test_result(p_test_config_store->publish(std::vector<therm_config>(3, heat_config)), therm_err_bad_config, 
+                                   "Bulk publish with the wrong zone count. Verify the settings are rejected");
+
+        // Load cool mode for the test zone from a file
+        const char* config_path = "/tmp/thermostat_test_config.txt";
+        {
+            std::ofstream config_file(config_path);
+            config_file << "# slot mode setpoint margin" << std::endl;
+            config_file << "0 cool 65.0 1.0" << std::endl;
+            config_file << "1 auto 68.0 1.5" << std::endl;
+        }
+        fail_count += test_result(p_test_config_store->load_file(config_path), therm_err_none, 
+                                   "Load settings file. Verify the settings are accepted");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_cooling, 
+                                   "Settings file cool mode. Above setpoint and margin. Verify the thermostat is cooling");
+        fail_count += test_result(p_test_API->get_therm_config().setpoint, 65.0f, 
+                                   "Settings file cool mode. Verify the setpoint was loaded");
+
+        // A settings file with an error is rejected as a whole, even the lines before the error
+        {
+            std::ofstream config_file(config_path);
+            config_file << "0 heat 70.0 2.0" << std::endl;
+            config_file << "1 warm 68.0 1.5" << std::endl;
+        }
+        fail_count += test_result(p_test_config_store->load_file(config_path), therm_err_bad_config, 
+                                   "Load settings file with an unknown mode. Verify the settings are rejected");
+        fail_count += test_result(p_test_API->get_therm_mode(), therm_mode_cool, 
+                                   "Load settings file with an unknown mode. Verify the settings are unchanged");
+        remove(config_path);
+
+        // Out of range slots are rejected, and leave the settings unchanged
+        therm_config before_config = p_test_API->get_therm_config();
+        fail_count += test_result(p_test_config_store->update_slot(test_config_slots, therm_config_field_all, heat_config), 
+                                   therm_err_bad_config, "Update an out of range slot. Verify the update is rejected");
+        fail_count += test_result(p_test_config_store->update_slot(-1, therm_config_field_all, heat_config), 
+                                   therm_err_bad_config, "Update a negative slot. Verify the update is rejected");
+        fail_count += test_result(p_test_API->get_therm_config().mode, before_config.mode, 
+                                   "Update an out of range slot. Verify the settings are unchanged");
+
+        // A thermostat given an out of range slot falls back to private settings
+        Thermostat_API* p_bad_slot_API = new Thermostat_API(p_test_config_store, test_config_slots);
+        p_bad_slot_API->set_temp_setpoint(55.0f);
+        fail_count += test_result(p_bad_slot_API->get_temp_setpoint(), 55.0f, 
+                                   "Thermostat with an out of range slot. Verify it keeps its own settings");
+        fail_count += test_result(p_test_API->get_temp_setpoint(), before_config.setpoint, 
+                                   "Thermostat with an out of range slot. Verify the shared settings are unchanged");
+
+        // A thermostat with private settings changes mode, setpoint and margin in one update
+        Thermostat_API* p_private_API = new Thermostat_API();
+        therm_config private_cool_config = { therm_mode_cool, 65.0f, 1.5f };
+        fail_count += test_result(p_private_API->set_therm_config(private_cool_config), therm_err_none, 
+                                   "Private settings. Set mode, setpoint and margin together. Verify they are accepted");
+        therm_config private_config = p_private_API->get_therm_config();
+        fail_count += test_result(private_config.mode, therm_mode_cool, 
+                                   "Private settings. Set together. Verify the mode");
+        fail_count += test_result(private_config.setpoint, 65.0f, 
+                                   "Private settings. Set together. Verify the setpoint");
+        fail_count += test_result(private_config.margin, 1.5f, 
+                                   "Private settings. Set together. Verify the margin");
+
+        // Stress: one writer alternates two full settings tables while readers check every snapshot
+        therm_config cool_config = { therm_mode_cool, 60.0f, 1.0f };
+        std::vector<therm_config> heat_configs(test_config_slots, heat_config);
+        std::vector<therm_config> cool_configs(test_config_slots, cool_config);
+        heat_configs[0] = cool_configs[0] = p_test_API->get_therm_config();
+        config_stress_state state;
+        state.running = true;
+        state.reads = 0;
+        state.torn_reads = 0;
+        std::thread reader_1(config_stress_reader, &state);
+        std::thread reader_2(config_stress_reader, &state);
+        int publish_count = 0;
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(500))
+        {
+            p_test_config_store->publish((publish_count % 2) ? cool_configs : heat_configs);
+            publish_count++;
+        }
+        state.running = false;
+        reader_1.join();
+        reader_2.join();
+        std::cout << "Information: " << publish_count << " bulk updates of " << test_config_slots << " zones, "
+                  << state.reads << " snapshot reads in 500 ms" << std::endl;
+        fail_count += test_result(state.torn_reads.load(), 0ul, 
+                                   "Bulk publish under concurrent reads. Verify no reader saw a mix of settings");
+
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+    }
+    std::cout << std::endl;
+}
+
+/// Test adaptive sensor sampling. Compare the messages sent by a sensor reporting every sample against a
+/// sensor honoring the advertised sampling rate, then verify a sudden change is still acted on promptly
+/// @param fail_count   Track the number of failed tests. Append to the count if a test fails
+/// @return             Nothing (void)
+void test_adaptive_sampling(int& fail_count)
+{
+    std::cout << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << "Adaptive Sampling Test Cases" << std::endl;
+    std::cout << "======================================================" << std::endl;
+    std::cout << std::endl;
+    if (nullptr != p_test_API)
+    {
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+
+        // Steady state, well above the heating threshold
+        p_test_API->set_temp_setpoint(70.0f);
+        p_test_API->set_temp_margin(2.0f);
+        p_test_API->set_therm_mode(therm_mode_heat);
+        const int sample_period_ms = 100;
+        const int sample_count = 30;
+
+        // A sensor that reports every sample
+        unsigned long rx_before = p_test_API->get_rx_count();
+        for (int i = 0; i < sample_count; i++)
+        {
+            send_UDP_temp_burst(75.0f, 1, server_address);
+            std::this_thread::sleep_for(std::chrono::milliseconds(sample_period_ms));
+        }
+        unsigned long fixed_rate_count = p_test_API->get_rx_count() - rx_before;
+
+        // The same sensor, now honoring the rate advertised while it was reporting every sample
+        sensor_client sensor = {};
+        for (int i = 0; i < sample_count; i++)
+        {
+            sensor_sample(sensor, 75.0f);
+            std::this_thread::sleep_for(std::chrono::milliseconds(sample_period_ms));
+        }
+        std::cout << "Information: steady state. Fixed rate sensor sent " << fixed_rate_count << ", adaptive sensor sent "
+                  << sensor.sent_count << " (advertised interval " << sensor.interval_ms << " ms, deadband "
+                  << std::fixed << std::setprecision(2) << sensor.deadband << ")" << std::endl;
+        fail_count += test_result(sensor.has_advert, true, 
+                                   "Adaptive sampling. Verify the sensor received a sampling rate advertisement");
+        fail_count += test_result(10 * sensor.sent_count <= static_cast<int>(fixed_rate_count), true, 
+                                   "Adaptive sampling. Steady state. Verify the sensor sends at least 10x fewer messages");
+
+        // A sudden drop below setpoint and margin exceeds the deadband and is reported straight away
+        sensor_sample(sensor, 67.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_heating, 
+                                   "Adaptive sampling. Sudden drop below setpoint and margin. Verify the thermostat is heating");
+
+        // Close to a threshold and changing fast, the sensor is asked to report more often
+        receive_UDP_rate(sensor);
+        std::cout << "Information: heating. Advertised interval " << sensor.interval_ms << " ms, deadband "
+                  << std::fixed << std::setprecision(2) << sensor.deadband << std::endl;
+        fail_count += test_result(sensor.interval_ms < 10000u, true, 
+                                   "Adaptive sampling. Heating, temperature falling fast. Verify the advertised interval shrinks");
+
+        // Turn the thermostat off, wait for the controller thread, then verify it's off
+        p_test_API->set_therm_mode(therm_mode_off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        fail_count += test_result(p_test_API->get_therm_status(), therm_status_inactive, 
+                                   "Set the thermostat to off. Verify the thermostat is inactive");
+    }
+    std::cout << std::endl;
+}
+
 int main()
 {
-    //Create a test API object
-    p_test_API = new Thermostat_API();
+    //Create a test API object, with its settings in a store shared with other (simulated) zones
+    therm_config default_config = { therm_mode_off, 72.0f, 1.0f };
+    p_test_config_store = new Therm_Config_Store(test_config_slots, default_config);
+    p_test_API = new Thermostat_API(p_test_config_store, 0);
 
     if (nullptr == p_test_API)
     {
@@ -428,6 +1502,24 @@ int main()
         // Test boundary cases
         test_boundary_cases(test_fail_count);
 
+        // Test the listener and controller against injected network faults
+        test_fault_injection(test_fail_count);
+
+        // Test change notification subscriptions
+        test_subscriptions(test_fail_count);
+
+        // Test aggregation of zones into floors, buildings and sites
+        test_aggregation(test_fail_count);
+
+        // Test the demand-response load coordinator
+        test_load_coordinator(test_fail_count);
+
+        // Test bulk configuration reloads
+        test_config_reload(test_fail_count);
+
+        // Test adaptive sensor sampling rate negotiation
+        test_adaptive_sampling(test_fail_count);
+
         std::cout << std::endl;
         std::cout << "|||||||||||||||||||||||||" << std::endl;
         std::cout << "TEST SUMMARY:" << std::endl;